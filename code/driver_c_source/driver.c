@@ -0,0 +1,302 @@
+/*========================================================================
+  PISA  (www.tik.ee.ethz.ch/pisa/)
+
+  ========================================================================
+  Computer Engineering (TIK)
+  ETH Zurich
+
+  ========================================================================
+  DRIVER - selector and variator in one program
+
+  Runs the LEX selector and the DTLZ variator, linked into this program
+  (see the 'lib' targets of their Makefiles), through the same sequence
+  of states as the monitor, but calls their state machines directly:
+  there are no state files, no polling, and the two modules exchange
+  the data through a segment in memory instead of the ini, var, sel
+  and arc files. The output files are the ones the monitor writes
+  (monitor_user.c).
+
+  Usage: driver varPar varBase selPar selBase monPar monBase
+
+  The arguments are those of the monitor without 'poll'; the cfg files
+  of varBase and selBase must exist.
+
+  file: driver.c
+  author: William La Cava, lacava@upenn.edu
+
+  ========================================================================
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+
+#include "monitor.h"
+#include "monitor_user.h"
+#include "monitor_internal.h"
+
+
+/*--------------------| selector and variator |-------------------------*/
+
+/* declared in selector_internal.h and variator_internal.h, which cannot
+   be included next to monitor_internal.h */
+
+int selector_open(char *param, char *filenamebase, void **memory);
+int selector_step(int state);
+
+int variator_open(char *param, char *filenamebase, void **memory);
+int variator_step(int state);
+
+
+/*--------------------| global variable definitions |-------------------*/
+
+/* declared in monitor.h, as in monitor.c */
+
+int alpha; /* number of individuals in initial population */
+int mu; /* number of individuals selected as parents */
+int lambda; /* number of offspring individuals */
+int dimension; /* number of objectives */
+double poll; /* not used, 0 in the information file */
+
+char filenamebase_variator[FILE_NAME_LENGTH_INTERNAL];
+char filenamebase_selector[FILE_NAME_LENGTH_INTERNAL];
+char parnamebase_selector[FILE_NAME_LENGTH_INTERNAL];
+char parnamebase_variator[FILE_NAME_LENGTH_INTERNAL];
+char filenamebase_monitor[FILE_NAME_LENGTH_INTERNAL];
+char parnamebase_monitor[FILE_NAME_LENGTH_INTERNAL];
+char cfg_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char ini_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char sel_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char arc_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char var_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char sta_file_variator[FILE_NAME_LENGTH_INTERNAL];
+char cfg_file_selector[FILE_NAME_LENGTH_INTERNAL];
+char ini_file_selector[FILE_NAME_LENGTH_INTERNAL];
+char sel_file_selector[FILE_NAME_LENGTH_INTERNAL];
+char arc_file_selector[FILE_NAME_LENGTH_INTERNAL];
+char var_file_selector[FILE_NAME_LENGTH_INTERNAL];
+char sta_file_selector[FILE_NAME_LENGTH_INTERNAL];
+
+int currentRun;
+int currentGeneration;
+
+
+/*-------------------------| steps |------------------------------------*/
+
+static void set_name(char *name, char *base, char *suffix)
+/* Sets 'name' (FILE_NAME_LENGTH_INTERNAL characters) to 'base'
+   followed by 'suffix' and exits if that does not fit. */
+{
+     int length = snprintf(name, FILE_NAME_LENGTH_INTERNAL, "%s%s", base,
+			   suffix);
+
+     if (length < 0 || length >= FILE_NAME_LENGTH_INTERNAL)
+     {
+	  printf("Driver - file name too long: %s%s\n", base, suffix);
+	  exit(1);
+     }
+}
+
+
+static void step(int (*module)(int), char *name, int state, int next)
+/* Does the steps of 'module' (variator_step or selector_step) in
+   'state' and exits unless it moves on to 'next'. With the data in
+   memory, a step never has to be tried again. */
+{
+     int result = module(state);
+
+     if (result != next)
+     {
+	  printf("Driver - %s moved from state %d to %d instead of %d\n",
+		 name, state, result, next);
+	  exit(1);
+     }
+}
+
+
+static double** read_records(char *filename, int count)
+/* Returns the 'count' records of the area for 'filename' as the
+   monitor's move_ini() and move_var() do: f[i][0] is the ID and
+   f[i][1..dimension] are the objective values. */
+{
+     int *ids = shm_ids(filename);
+     double *values = shm_values(filename);
+     double **f = NULL;
+     int i, j;
+
+     assert(get_shm_word(filename) == count);
+     f = (double **) malloc(count * sizeof(double*));
+     assert(f != NULL);
+     for (i = 0; i < count; i++)
+     {
+	 f[i] = (double *) malloc((dimension + 1) * sizeof(double));
+	 assert(f[i] != NULL);
+	 f[i][0] = ids[i];
+	 for (j = 1; j < dimension + 1; j++)
+	     f[i][j] = values[i * dimension + j - 1];
+     }
+     return (f);
+}
+
+
+static void free_records(double **f, int count)
+/* Frees the records returned by read_records(). */
+{
+     int i;
+
+     for (i = 0; i < count; i++)
+	 free(f[i]);
+     free(f);
+}
+
+
+static void record_archive()
+/* Records the archive the selector has just written with state2_user()
+   and appends it to the output, as copyArchiveSelected() and
+   appendOutput() do in the monitor. */
+{
+     int size = get_shm_word(arc_file_selector);
+     int *id = NULL;
+
+     assert(size > 0); /* we need to keep at least one individual */
+     id = (int *) malloc(sizeof(int) * (size + 1));
+     assert(id != NULL);
+     id[0] = size; /* Store size of array in first entry */
+     memcpy(id + 1, shm_ids(arc_file_selector), sizeof(int) * size);
+     state2_user(id);
+     free(id);
+     appendOutput();
+}
+
+
+static void reset_all()
+/* Resets the variator and the selector and creates the first archive,
+   sample and offspring, as the monitor's resetAll() does. */
+{
+     double **f = NULL;
+     int i;
+
+     if (LOG) printf("  starting reset\n");
+     currentGeneration = 0;
+     step(variator_step, "variator", 8, 9);
+     step(selector_step, "selector", 10, 11);
+
+     /* the variator draws from rand() as well, after seeding it in
+        state 0: replay the monitor's own sequence up to this run */
+     srand(seed);
+     for (i = 0; i < currentRun; i++)
+	  irand(INT_MAX);
+     updateVariatorSeed();
+     set_shm_word(ini_file_variator, 0);
+     step(variator_step, "variator", 0, 1);
+     if (LOG) printf("  currentGeneration = %d \n", currentGeneration);
+
+     f = read_records(ini_file_variator, alpha);
+     state1_user(f);
+     free_records(f, alpha);
+     set_shm_word(arc_file_selector, 0);
+     set_shm_word(sel_file_selector, 0);
+     step(selector_step, "selector", 1, 2);
+     if (LOG) printf("    ini_pop done; selection done\n");
+
+     record_archive();
+     set_shm_word(var_file_variator, 0);
+     step(variator_step, "variator", 2, 3);
+}
+
+
+/*-------------------------| main() |-----------------------------------*/
+
+int main(int argc, char *argv[])
+{
+     void *memory = NULL; /* segment of the selector and the variator */
+     double **f = NULL;
+
+     if (argc == 7)
+     {
+          set_name(parnamebase_variator, argv[1], "");
+          set_name(filenamebase_variator, argv[2], "");
+          set_name(parnamebase_selector, argv[3], "");
+          set_name(filenamebase_selector, argv[4], "");
+          set_name(parnamebase_monitor, argv[5], "");
+          set_name(filenamebase_monitor, argv[6], "");
+          poll = 0;
+     }
+     else
+     {
+          printf("Driver - wrong number of arguments:\n");
+          printf("driver varPar varBase selPar selBase monPar monBase\n");
+          return (1);
+     }
+
+     /* generate file names based on 'filenamebase'; the data files
+        name the words and areas of the segment */
+     set_name(var_file_variator, filenamebase_variator, "var");
+     set_name(sel_file_variator, filenamebase_variator, "sel");
+     set_name(cfg_file_variator, filenamebase_variator, "cfg");
+     set_name(ini_file_variator, filenamebase_variator, "ini");
+     set_name(arc_file_variator, filenamebase_variator, "arc");
+     set_name(sta_file_variator, filenamebase_variator, "sta");
+     set_name(var_file_selector, filenamebase_selector, "var");
+     set_name(sel_file_selector, filenamebase_selector, "sel");
+     set_name(cfg_file_selector, filenamebase_selector, "cfg");
+     set_name(ini_file_selector, filenamebase_selector, "ini");
+     set_name(arc_file_selector, filenamebase_selector, "arc");
+     set_name(sta_file_selector, filenamebase_selector, "sta");
+
+     /* read and check common parameters (they should be equal) */
+     alpha = 0;
+     mu = 0;
+     lambda = 0;
+     dimension = 0;
+     read_common_parameters(cfg_file_variator);
+     read_common_parameters(cfg_file_selector);
+
+     /* the variator sets up the segment, the selector attaches to it */
+     if (variator_open(parnamebase_variator, filenamebase_variator,
+		       &memory) != 0
+	 || selector_open(parnamebase_selector, filenamebase_selector,
+			  &memory) != 0)
+     {
+          printf("Driver - cannot set up the variator and the selector\n");
+          return (1);
+     }
+     use_memory_segment(memory);
+
+     /* read monitor parameters */
+     read_local_parameters();
+
+     /* print information file of monitor */
+     printInformation();
+
+     for (currentRun = 0; currentRun < numberOfRuns; currentRun++)
+     {
+	  if (LOG) printf("currentRun = %d \n", currentRun);
+	  reset_all();
+	  for (currentGeneration = 1; currentGeneration <= numberOfGenerations;
+	       currentGeneration++)
+	  {
+	       if (LOG) printf("  currentGeneration = %d \n",
+			       currentGeneration);
+	       f = read_records(var_file_variator, lambda);
+	       state3_user(f);
+	       free_records(f, lambda);
+	       step(selector_step, "selector", 3, 2);
+	       if (LOG) printf("    variation done; selection done\n");
+
+	       record_archive();
+	       step(variator_step, "variator", 2, 3);
+	  }
+     }
+
+     if (LOG) printf("selector state 6 (kill)\n");
+     step(selector_step, "selector", 6, 7);
+     if (LOG) printf("variator state 4 (kill)\n");
+     step(variator_step, "variator", 4, 5);
+
+     free(memory);
+     return (0);
+}
@@ -76,6 +76,12 @@ int read_arc();
 void del_arc();
 /* Deletes the content of the arc file. */
 
+int hold_individuals(int *identity, int size);
+/* Makes read_arc() keep the 'size' individuals with the IDs in
+   'identity' as well, until it is called again ('size' 0 releases
+   them). This is for offspring the selector has not seen yet.
+   Returns 0 if successful and 1 otherwise. */
+
 int read_sel(int *id_array); 
 /* Reads a list of IDs from the sel_file. These IDs denote the
    individuals chosen as parents. The IDs of the individuals are
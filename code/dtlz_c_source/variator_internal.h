@@ -80,11 +80,204 @@ int wait(double sec);
   post: Calling process is sleeping for 'sec' * 1e6 microseconds.
         The requested time is rounded up to the next integer multiple
         of the resolution the system can deliver.
+        On Linux the process wakes up earlier as soon as the state file
+        is written (watched with inotify), or with the shared memory
+        transport, as soon as the segment is written (with a futex); it
+        falls back to sleeping if neither is available.
+        With the socket transport, it answers the monitor meanwhile
+        and returns as soon as the monitor has set the state.
 
   CAUTION: sleep and usleep() are not standard C, use Sleep(milliseconds)
            in <windows.h> for Windows version.
 */
 
+/*-------------------| running in one program |-------------------------*/
+
+/* The driver (driver_c_source) links the variator and the selector
+   into one program and runs their state machines itself, without
+   main(), the state file or the monitor. These two functions are all
+   it calls. */
+
+int variator_open(char *param, char *filenamebase, void **memory);
+/* Sets up the variator with the parameter file 'param' and the cfg file
+   of 'filenamebase', exchanging the data through the segment '*memory'
+   (see open_memory_transport()).
+   Returns 0 if successful and 1 otherwise. */
+
+int variator_step(int state);
+/* Does the steps required in 'state'. Returns the next state, 'state'
+   if the step has to be tried again and -1 if 'state' does not concern
+   the variator. */
+
+
+/*-------------------| shared memory transport |------------------------*/
+
+/* With the entry 'transport shm' in the cfg file, the state and the
+   contents of the ini, var, sel and arc files are exchanged through a
+   POSIX shared memory segment instead of the files. The segment is
+   named after the absolute path of the filename base, so the monitor
+   finds it from another directory. It holds one word per file (the
+   state, or the number of records, 0 standing for a file containing
+   only '0') and an area of records (IDs, and objective values for ini
+   and var) per data file. The monitor removes the segment when it
+   terminates. */
+
+#define TRANSPORT_FILE 0 /* exchange through the files (default) */
+#define TRANSPORT_SHM 1  /* exchange through shared memory */
+#define TRANSPORT_SOCKET 2 /* exchange over a socket (see below) */
+
+#define SHM_STA 0 /* words of the segment, and areas for the data files */
+#define SHM_INI 1
+#define SHM_VAR 2
+#define SHM_SEL 3
+#define SHM_ARC 4
+#define SHM_WORDS 5
+
+extern int transport; /* TRANSPORT_FILE, TRANSPORT_SHM or
+                         TRANSPORT_SOCKET */
+
+int open_transport(char *filenamebase);
+/* Reads the cfg file, if it exists yet, and attaches the shared memory
+   segment of 'filenamebase' if it asks for 'transport shm'.
+   Returns 0 if successful and 1 otherwise. */
+
+int get_shm_word(int word);
+/* Returns the word 'word' (SHM_STA ... SHM_ARC) of the segment. */
+
+void set_shm_word(int word, int value);
+/* Sets the word 'word' of the segment and wakes up the processes
+   waiting for a change. Write the records of an area before setting
+   its word. */
+
+int shm_capacity(void);
+/* Returns the number of records an area can hold. */
+
+int *shm_ids(int area);
+/* Returns the IDs of the records in 'area' (SHM_INI ... SHM_ARC). */
+
+double *shm_values(int area);
+/* Returns the objective values of the records in 'area' (SHM_INI or
+   SHM_VAR), 'dimension' values per record. */
+
+int open_memory_transport(void **memory);
+/* Switches to the shared memory transport on a segment in the memory
+   of this process, for running in one program with the selector: on
+   a new segment, stored in '*memory', if '*memory' is NULL, and on the
+   segment '*memory' otherwise. The common parameters must have been
+   read. Returns 0 if successful and 1 otherwise. */
+
+
+/*-------------------------| socket transport |-------------------------*/
+
+/* With the entry 'transport socket <address>' in the cfg file, the
+   variator keeps the words and areas of the shared memory transport in
+   its own memory, and the monitor reads and writes them over a stream
+   socket, so the variator and the selector can run on other hosts than
+   the monitor. <address> is 'host:port' for TCP or the path of a Unix
+   domain socket (without a ':'). The variator listens on 'port' of
+   'host' (on all addresses if 'host' is empty) or on the path followed
+   by '.variator', the selector on port + 1 or the path followed by
+   '.selector' (see module_address()), so both may be given the same
+   cfg file. A Unix domain socket another process listens on is not
+   taken over. The variator answers the monitor in read_state() and
+   wait(), and wait() returns as soon as the monitor has set the state.
+
+   Each message starts with four 32-bit words: SOCKET_MAGIC, the
+   request (SOCKET_GET, SOCKET_SET or SOCKET_WAIT), the word (SHM_STA
+   ... SHM_ARC) and its value. For the word of an area, the records
+   follow: the IDs as 32-bit words, then for ini and var the objective
+   values as doubles, 'dimension' per record. A GET is answered with the same
+   message carrying the value of the word (and the records); a SET
+   carries the new value and records and is not answered. A WAIT for
+   the state carries the state the monitor has seen and is answered,
+   like a GET, once the variator has written another one; until then
+   the monitor sends nothing else. Both hosts must use the same byte
+   order, which SOCKET_MAGIC checks. */
+
+#define SOCKET_MAGIC 0x4b534950 /* "PISK" */
+#define SOCKET_GET 1  /* read a word, and its records */
+#define SOCKET_SET 2  /* write a word, and its records */
+#define SOCKET_WAIT 3 /* read the state once it has changed */
+
+int data_unfetched(void);
+/* Returns 1 if the monitor has not fetched the var data written last
+   over the socket transport yet, and 0 otherwise (always with the
+   other transports, where the monitor reads the data by itself). */
+
+int close_transport(int block);
+/* With the socket transport, answers the monitor until it closes the
+   connection, which it does when it has read the last state, and then
+   closes the sockets. If 'block' is 0, only the requests already there
+   are answered. Returns 0 once the sockets are closed (at once with the
+   other transports) and 1 if the monitor is still connected. */
+
+/*-------------------------| data files |-------------------------------*/
+
+/* The ini, var, sel and arc files are written to a temporary file
+   (the name with '.tmp' appended) that is renamed into place when it
+   is complete, so a reader never sees a partly written file and does
+   not have to read it again. Readers read a whole file with a single
+   read (read_data()). */
+
+/* #define PISA_FSYNC */ /**** define to fsync() the data files before
+                            renaming them, so that they survive a crash
+                            of the host (Unix only) */
+
+FILE *begin_file(char *filename);
+/* Opens the temporary file for writing the new content of 'filename'.
+   Returns NULL if this fails. */
+
+int publish_file(FILE *fp, char *filename);
+/* Closes 'fp', opened by begin_file(), and renames it to 'filename'.
+   Returns 0 if successful and 1 otherwise. */
+
+void empty_file(char *filename);
+/* Leaves only '0' in the file 'filename'. */
+
+
+/*-------------------------| binary files |-----------------------------*/
+
+/* With the entry 'format binary' in the cfg file, the ini, var, sel and
+   arc files are written in a binary format: the magic "PISB", the
+   number of records, the number of objective values per record (0 in
+   sel and arc files) and an unused word, all 32 bit; then the IDs,
+   padded to a multiple of 8 bytes, and the objective values as
+   doubles, all little-endian. A file is written with a single write.
+   The readers accept both formats, so modules that only know the text
+   format can still be given the text files, and a file emptied by its
+   reader always contains the text '0'. */
+
+#define FORMAT_TEXT 0   /* text files (default) */
+#define FORMAT_BINARY 1 /* binary files */
+
+extern int format; /* format of the files written, FORMAT_TEXT or
+                      FORMAT_BINARY */
+
+typedef struct binary_data_t
+{
+     int count;      /* number of records */
+     int dimension;  /* objective values per record */
+     int *ids;       /* IDs of the records */
+     double *values; /* objective values, 'dimension' per record */
+     char *buffer;   /* the whole file */
+     size_t size;    /* its size in bytes */
+} binary_data;
+
+int new_binary(binary_data *data, int count, int dimension);
+/* Allocates the buffer of 'data' for 'count' records with 'dimension'
+   objective values each and sets up the header; the caller fills in
+   'ids' and 'values'. Returns 0 if successful and 1 otherwise. */
+
+int write_binary(char *filename, binary_data *data);
+/* Writes 'data' to 'filename' and frees its buffer.
+   Returns 0 if successful and 1 otherwise. */
+
+int read_data(char *filename, int dimension, binary_data *data);
+/* Reads the data file 'filename', in either format, into 'data' with a
+   single read of the whole file. 'dimension' is the number of objective
+   values per record, 0 for sel and arc files. Returns 0 if successful
+   (free 'data->buffer' when done) and 1 if the file cannot be read or
+   is not completely written or invalid. */
 
 
 /*-------------------------| stack |------------------------------------*/
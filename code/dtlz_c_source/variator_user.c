@@ -55,6 +55,16 @@ double variable_swap_probability;
 double variable_recombination_probability;
 double eta_mutation;
 double eta_recombination;
+eval_function eval_problem = NULL;   /* functions of 'problem', see */
+batch_function eval_problem_batch = NULL; /* resolve_problem() */
+int steady = 0; /* 1 to make the next offspring while the selector
+                   selects (optional parameter) */
+/* steady state: the parents of the next offspring (if 'have_parents')
+   and these offspring, made ready and held (if 'have_offspring') */
+int *next_parents = NULL;
+int have_parents = 0;
+int *ready_offspring = NULL;
+int have_offspring = 0;
 
 /*-------------------------| individual |-------------------------------*/
 
@@ -158,11 +168,11 @@ int state0()
      for(i = 0; i < alpha; i++)
      {
  	 individual *ind = new_individual();
-	 eval(ind);
 	 initial_population[i] = add_individual(ind);
          if(initial_population[i] == -1)
             return(1);
      } 
+     eval_batch(alpha, initial_population);
 
      gen = 1;
      
@@ -221,6 +231,16 @@ int state2()
           return (1);
      }
      
+     /**********| added for DTLZ |**************/
+
+     /* steady state: if the selector was faster than
+        prepare_offspring(), make up for it before read_arc() removes the
+        parents, so the children do not depend on the timing */
+     if (prepare_offspring() == 1)
+          return (1);
+
+     /**********| addition for DTLZ end |*******/
+
      result = read_sel(parent_identities);
      if (result != 0) /* if some file reading error occurs, return 2 */
           return (2);
@@ -231,7 +251,10 @@ int state2()
 
      /**********| added for DTLZ |**************/
 
-     result = variate(parent_identities, offspring_identities);
+     if (steady)
+          result = steady_variate(parent_identities, offspring_identities);
+     else
+          result = variate(parent_identities, offspring_identities);
      if (result != 0)
           return (1);
           
@@ -256,6 +279,32 @@ int state2()
 }
  
 
+int prepare_offspring()
+/* Called instead of waiting while the selector selects.
+
+   post: Optionally (steady state) the next 'lambda' children generated
+         from the parents read in the last state2(), added to the global
+         population and held with hold_individuals(), for the next
+         state2() to write them right away.
+         Return value == 0 if something was done,
+                      == 1 if unspecified errors happened,
+                      == 2 if there was nothing to do.
+*/
+{
+     /**********| added for DTLZ |**************/
+
+     if (!steady || !have_parents || have_offspring)
+          return (2);
+     if (variate(next_parents, ready_offspring) != 0)
+          return (1);
+     have_parents = 0;
+     have_offspring = 1;
+     return (hold_individuals(ready_offspring, lambda));
+
+     /**********| addition for DTLZ end |*******/
+}
+
+
 int state4() 
 /* Do what needs to be done in state 4.
 
@@ -270,6 +319,9 @@ int state4()
      /**********| added for DTLZ |**************/
      
      int result;
+
+     have_parents = have_offspring = 0; /* unwritten offspring go */
+     hold_individuals(NULL, 0);
      result = read_arc();
 
      if (0 == result) /* arc file correctly read
@@ -317,7 +369,9 @@ int state8()
    int result;
    
    gen = 1;
-     
+
+   have_parents = have_offspring = 0; /* unwritten offspring go */
+   hold_individuals(NULL, 0);
    result = read_arc();
 
    if (0 == result) /* arc file correctly read
@@ -366,6 +420,7 @@ int is_finished()
 int read_local_parameters()
 {
      FILE *fp;
+     int result;
      char str[CFG_NAME_LENGTH];
 
      /* reading parameter file with parameters for selection */
@@ -390,6 +445,11 @@ int read_local_parameters()
      assert(strcmp(str, "problem") == 0);
      fscanf(fp, "%s", problem); /* fscanf() returns EOF if
                                    reading failed. */
+     if (resolve_problem() != 0)
+     {
+          fclose(fp);
+          return (1);
+     }
 
      fscanf(fp, "%s", str);
      assert(strcmp(str, "seed") == 0);
@@ -438,6 +498,39 @@ int read_local_parameters()
      assert(strcmp(str, "eta_recombination") == 0);
      fscanf(fp, "%le", &eta_recombination);
 
+     /* optional parameters */
+     steady = 0;
+     while (fscanf(fp, "%s", str) == 1)
+     {
+          if (strcmp(str, "steady") == 0)
+          {
+               result = fscanf(fp, "%d", &steady);
+               assert(result == 1);
+          }
+          else
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "unknown parameter in parameter file");
+               fclose(fp);
+               return (1);
+          }
+     }
+     if (steady)
+     {
+          free(next_parents);
+          free(ready_offspring);
+          next_parents = (int *) malloc(mu * sizeof(int));
+          ready_offspring = (int *) malloc(lambda * sizeof(int));
+          have_parents = have_offspring = 0;
+          if (next_parents == NULL || ready_offspring == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "variator out of memory");
+               fclose(fp);
+               return (1);
+          }
+     }
+
      srand(seed); /* seeding random number generator */
 
      fclose(fp);
@@ -446,6 +539,25 @@ int read_local_parameters()
 }
 
 
+/* Steady state: returns the children prepare_offspring() made ready in
+   'offspring' and keeps 'parents' for the next ones. */
+int steady_variate(int *parents, int *offspring)
+{
+     if (have_offspring)
+     {
+          memcpy(offspring, ready_offspring, lambda * sizeof(int));
+          have_offspring = 0;
+          if (hold_individuals(NULL, 0) != 0)
+               return (1);
+     }
+     else if (variate(parents, offspring) != 0) /* first offspring */
+          return (1);
+     memcpy(next_parents, parents, mu * sizeof(int));
+     have_parents = 1;
+     return (0);
+}
+
+
 /* Performs variation. */
 int variate(int *selected, int *result_ids)
 {
@@ -513,12 +625,8 @@ int variate(int *selected, int *result_ids)
           }
      }
      
-     /* do evaluation */
-     for(i = 0; i < mu; i++)
-     {
-          int result;
-          result = eval(get_individual(result_ids[i]));
-     }
+     /* do evaluation, all offspring at once */
+     eval_batch(mu, result_ids);
      
      return (0);
 }
@@ -707,91 +815,108 @@ double drand(double range)
      return (j);
 }
 
-/* Determines the objective value based on DTLZ */
-int eval(individual *ind)
+/* the problems by name, with their batch kernels where there are any */
+problem_entry problems[] = {
+    {"DTLZ1", eval_DTLZ1, batch_DTLZ1},
+    {"DTLZ2", eval_DTLZ2, batch_DTLZ2},
+    {"DTLZ3", eval_DTLZ3, batch_DTLZ3},
+    {"DTLZ4", eval_DTLZ4, batch_DTLZ4},
+    {"DTLZ5", eval_DTLZ5, batch_DTLZ5},
+    {"DTLZ6", eval_DTLZ6, batch_DTLZ6},
+    {"DTLZ7", eval_DTLZ7, batch_DTLZ7},
+    {"COMET", eval_COMET, NULL},
+    {"ZDT1", eval_ZDT1, batch_ZDT1},
+    {"ZDT2", eval_ZDT2, batch_ZDT2},
+    {"ZDT3", eval_ZDT3, batch_ZDT3},
+    {"ZDT4", eval_ZDT4, batch_ZDT4},
+    {"ZDT6", eval_ZDT6, batch_ZDT6},
+    {"SPHERE", eval_SPHERE, NULL},
+    {"KUR", eval_KUR, NULL},
+    {"QV", eval_QV, NULL},
+    {NULL, NULL, NULL}
+};
+
+/* Sets 'eval_problem' and 'eval_problem_batch' to the functions of
+   'problem'. Returns 0 if successful and 1 if the problem is unknown. */
+int resolve_problem()
 {
-    if (strcmp(problem, "DTLZ1") == 0)
-    {
-	return (eval_DTLZ1(ind));
-    }
-    
-    if (strcmp(problem, "DTLZ2") == 0)
-    {
-	return (eval_DTLZ2(ind));
-    }
-    
-    if (strcmp(problem, "DTLZ3") == 0)
-    {
-	return (eval_DTLZ3(ind));
-    }
-    
-    if (strcmp(problem, "DTLZ4") == 0)
-    {
-	return (eval_DTLZ4(ind));
-    }
-
-    if (strcmp(problem, "DTLZ5") == 0)
-    {
-	return (eval_DTLZ5(ind));
-    }
-
-    if (strcmp(problem, "DTLZ6") == 0)
-    {
-	return (eval_DTLZ6(ind));
-    }
-
-    if (strcmp(problem, "DTLZ7") == 0)
-    {
-	return (eval_DTLZ7(ind));
-    }
-
-    if (strcmp(problem, "COMET") == 0)
-    {
-	return (eval_COMET(ind));
-    }
+    int i;
 
-    if (strcmp(problem, "ZDT1") == 0)
-    {
-	return (eval_ZDT1(ind));
-    }
+    for (i = 0; problems[i].name != NULL; i++)
+        if (strcmp(problem, problems[i].name) == 0)
+        {
+            eval_problem = problems[i].eval;
+            eval_problem_batch = problems[i].batch;
+            return (0);
+        }
+    eval_problem = NULL;
+    eval_problem_batch = NULL;
+    log_to_file(log_file, __FILE__, __LINE__, "unknown problem specified");
+    return (1);
+}
 
-    if (strcmp(problem, "ZDT2") == 0)
+/* Determines the objective value based on DTLZ */
+int eval(individual *ind)
+{
+    if (eval_problem == NULL)
     {
-	return (eval_ZDT2(ind));
+        log_to_file(log_file, __FILE__, __LINE__, "unknown problem specified");
+        return (1);
     }
+    return (eval_problem(ind));
+}
 
-    if (strcmp(problem, "ZDT3") == 0)
+/* Determines the objective values of the 'count' individuals with the
+   IDs in 'identities', with one call of the batch kernel of the problem
+   if it has one. Returns 0 if successful and 1 otherwise. */
+int eval_batch(int count, int *identities)
+{
+    static double *memory = NULL; /* x, f and work of the kernels */
+    static size_t capacity = 0;
+    size_t needed;
+    double *x, *f;
+    int i, c;
+    int result = 0;
+
+    if (eval_problem_batch == NULL || count <= 0)
     {
-	return (eval_ZDT3(ind));
+        for (c = 0; c < count; c++)
+            if (eval(get_individual(identities[c])) != 0)
+                result = 1;
+        return (result);
     }
 
-    if (strcmp(problem, "ZDT4") == 0)
+    needed = (size_t) count
+        * (number_decision_variables + 3 * dimension + 1);
+    if (needed > capacity)
     {
-	return (eval_ZDT4(ind));
+        free(memory);
+        memory = (double *) malloc(needed * sizeof(double));
+        capacity = (memory != NULL) ? needed : 0;
+        if (memory == NULL)
+        {
+            log_to_file(log_file, __FILE__, __LINE__,
+                        "variator out of memory");
+            return (1);
+        }
     }
+    x = memory;
+    f = x + (size_t) count * number_decision_variables;
 
-    if (strcmp(problem, "ZDT6") == 0)
-    {
-	return (eval_ZDT6(ind));
-    }
-    
-    if (strcmp(problem, "SPHERE") == 0)
+    for (c = 0; c < count; c++) /* gather */
     {
-	return (eval_SPHERE(ind));
+        individual *ind = get_individual(identities[c]);
+        for (i = 0; i < number_decision_variables; i++)
+            x[(size_t) i * count + c] = ind->x[i];
     }
-    
-    if (strcmp(problem, "KUR") == 0)
+    result = eval_problem_batch(count, x, f, f + (size_t) count * dimension);
+    for (c = 0; c < count; c++) /* scatter */
     {
-	return (eval_KUR(ind));
+        individual *ind = get_individual(identities[c]);
+        for (i = 0; i < dimension; i++)
+            ind->f[i] = f[(size_t) i * count + c];
     }
-    
-    if (strcmp(problem, "QV") == 0)
-    {
-	return (eval_QV(ind));
-    }
-
-    log_to_file(log_file, __FILE__, __LINE__, "unknown problem specified");
-    return (1);
+    return (result);
 }
 
 int eval_DTLZ1(individual *ind)
@@ -826,10 +951,39 @@ int eval_DTLZ1(individual *ind)
     return(0);
 }
 
+/* The objectives of the DTLZ problems with a spherical front,
+   f_i = scale * cos(t_1) ... cos(t_{m-i}) * sin(t_{m-i+1}). The angles
+   t_j are 'theta' if not NULL, otherwise the decision variables (raised
+   to the power 100 if 'power') times pi / 2. All m objectives come from
+   one running product of the cosines, so each angle costs one cos() and
+   one sin() and the whole front O(m) instead of O(m^2). The order of
+   the multiplications differs from the textbook formula, so the values
+   may differ from it in the last bits. */
+static void spherical_front(individual *ind, double scale,
+                            const double *theta, int power)
+{
+    int j;
+    int m = dimension;
+    double p = scale; /* scale * cos(t_1) ... cos(t_{j-1}) */
+
+    for (j = 1; j < m; j++)
+    {
+	double angle;
+	if (theta != NULL)
+	    angle = theta[j-1];
+	else if (power)
+	    angle = pow(ind->x[j-1], 100) * PISA_PI / 2;
+	else
+	    angle = ind->x[j-1] * PISA_PI / 2;
+	ind->f[m-j] = p * sin(angle);
+	p *= cos(angle);
+    }
+    ind->f[0] = p;
+}
+
 int eval_DTLZ2(individual *ind)
 {    
     int i = 0;
-    int j = 0;
     int n = number_decision_variables;
     int k = n - dimension + 1;
     
@@ -839,20 +993,7 @@ int eval_DTLZ2(individual *ind)
 	g += pow(ind->x[i-1]-0.5,2);
     }
     
-    for (i = 1; i <= dimension; i++)
-    {
-	double f = (1 + g);
-	for (j = dimension - i; j >= 1; j--)
-	{
-	    f *= cos(ind->x[j-1] * PISA_PI / 2);
-	}
-	if (i > 1)
-	{
-	    f *= sin(ind->x[(dimension - i + 1) - 1] * PISA_PI / 2);
-	}
-
-	ind->f[i-1] = f;
-    }
+    spherical_front(ind, 1 + g, NULL, 0);
 
     return(0);
 }
@@ -862,7 +1003,6 @@ int eval_DTLZ2(individual *ind)
 int eval_DTLZ3(individual *ind)
 {    
     int i = 0;
-    int j = 0;
     int n = number_decision_variables;
     int k = n - dimension + 1;
     
@@ -873,20 +1013,7 @@ int eval_DTLZ3(individual *ind)
     }
     g = 100 * (k + g);
     
-    for (i = 1; i <= dimension; i++)
-    {
-	double f = (1 + g);
-	for (j = dimension - i; j >= 1; j--)
-	{
-	    f *= cos(ind->x[j-1] * PISA_PI / 2);
-	}
-	if (i > 1)
-	{
-	    f *= sin(ind->x[(dimension - i + 1) - 1] * PISA_PI / 2);
-	}
-
-	ind->f[i-1] = f;
-    }
+    spherical_front(ind, 1 + g, NULL, 0);
 
     return(0);
 }
@@ -894,8 +1021,6 @@ int eval_DTLZ3(individual *ind)
 int eval_DTLZ4(individual *ind)
 {    
     int i = 0;
-    int j = 0;
-    double alpha = 100;
     int n = number_decision_variables;
     int k = n - dimension + 1;
     
@@ -905,20 +1030,7 @@ int eval_DTLZ4(individual *ind)
 	g += pow(ind->x[i-1]-0.5,2);
     }
     
-    for (i = 1; i <= dimension; i++)
-    {
-	double f = (1 + g);
-	for (j = dimension - i; j >= 1; j--)
-	{
-	    f *= cos(pow(ind->x[j-1],alpha) * PISA_PI / 2);
-	}
-	if (i > 1)
-	{
-	    f *= sin(pow(ind->x[(dimension - i + 1) - 1],alpha) * PISA_PI / 2);
-	}
-
-	ind->f[i-1] = f;
-    }
+    spherical_front(ind, 1 + g, NULL, 1);
 
     return(0);
 }
@@ -926,7 +1038,6 @@ int eval_DTLZ4(individual *ind)
 int eval_DTLZ5(individual *ind)
 {    
     int i = 0;
-    int j = 0;
     int n = number_decision_variables;
     int k = n - dimension + 1;
     double *theta = malloc(dimension * sizeof(double));
@@ -945,20 +1056,7 @@ int eval_DTLZ5(individual *ind)
 	theta[i-1] = t * (1 + 2 * g * ind->x[i-1]);
     }
     
-    for (i = 1; i <= dimension; i++)
-    {
-	double f = (1 + g);
-	for (j = dimension - i; j >= 1; j--)
-	{
-	    f *= cos(theta[j-1]);
-	}
-	if (i > 1)
-	{
-	    f *= sin(theta[(dimension - i + 1) - 1]);
-	}
-
-	ind->f[i-1] = f;
-    }
+    spherical_front(ind, 1 + g, theta, 0);
 
     free(theta);
     return(0);
@@ -967,7 +1065,6 @@ int eval_DTLZ5(individual *ind)
 int eval_DTLZ6(individual *ind)
 {    
     int i = 0;
-    int j = 0;
     int n = number_decision_variables;
     int k = n - dimension + 1;
     double *theta = malloc(dimension * sizeof(double));
@@ -986,20 +1083,7 @@ int eval_DTLZ6(individual *ind)
 	theta[i-1] = t * (1 + 2 * g * ind->x[i-1]);
     }
     
-    for (i = 1; i <= dimension; i++)
-    {
-	double f = (1 + g);
-	for (j = dimension - i; j >= 1; j--)
-	{
-	    f *= cos(theta[j-1]);
-	}
-	if (i > 1)
-	{
-	    f *= sin(theta[(dimension - i + 1) - 1]);
-	}
-
-	ind->f[i-1] = f;
-    }
+    spherical_front(ind, 1 + g, theta, 0);
 
     free(theta);
     return(0);
@@ -1271,6 +1355,367 @@ int eval_QV(individual *ind)
     return(0);
 }
 
+/* Batch kernels: evaluate 'count' individuals at once. The decision
+   variables come as a structure of arrays, variable i of individual c
+   in x[i * count + c], and the objective values go to f[o * count + c].
+   'work' has room for (2 * dimension + 1) * count doubles. The inner
+   loops run over the individuals, and every transcendental function is
+   applied to a whole column before it is used, so the loops can be
+   vectorized. Each individual gets exactly the operations of the
+   corresponding eval_X() function, in the same order, so the objective
+   values do not change. */
+
+/* cos() and sin() of the angles of the first dimension - 1 columns,
+   into 'co' and 'si': the columns of 'theta' if not NULL, otherwise
+   those of 'x' (raised to the power 100 if 'power') times pi / 2. */
+static void angle_columns(int count, const double *x, const double *theta,
+                          int power, double *co, double *si)
+{
+    int j, c;
+    int m = dimension;
+
+    for (j = 0; j < m - 1; j++)
+    {
+        const double *xj = x + (size_t) j * count;
+        const double *tj = (theta != NULL) ? theta + (size_t) j * count
+                                           : NULL;
+        double *cj = co + (size_t) j * count;
+        double *sj = si + (size_t) j * count;
+        for (c = 0; c < count; c++)
+        {
+            double angle;
+            if (tj != NULL)
+                angle = tj[c];
+            else if (power)
+                angle = pow(xj[c], 100) * PISA_PI / 2;
+            else
+                angle = xj[c] * PISA_PI / 2;
+            cj[c] = cos(angle);
+            sj[c] = sin(angle);
+        }
+    }
+}
+
+/* f = 'scale' times the products of the columns of 'co' and 'si', with
+   the running product of spherical_front() kept in the row of f_1 */
+static void spherical_objectives(int count, const double *scale,
+                                 const double *co, const double *si,
+                                 double *f)
+{
+    int j, c;
+    int m = dimension;
+    double *f0 = f;
+
+    for (c = 0; c < count; c++)
+        f0[c] = scale[c];
+    for (j = 1; j < m; j++)
+    {
+        const double *cj = co + (size_t) (j - 1) * count;
+        const double *sj = si + (size_t) (j - 1) * count;
+        double *fj = f + (size_t) (m - j) * count;
+        for (c = 0; c < count; c++)
+        {
+            fj[c] = f0[c] * sj[c];
+            f0[c] *= cj[c];
+        }
+    }
+}
+
+/* g of DTLZ1 and DTLZ3 for the last k variables, into 'g' */
+static void rastrigin_g(int count, const double *x, double *g)
+{
+    int i, c;
+    int n = number_decision_variables;
+    int k = n - dimension + 1;
+
+    for (c = 0; c < count; c++)
+        g[c] = 0;
+    for (i = n - k + 1; i <= n; i++)
+    {
+        const double *xi = x + (size_t) (i - 1) * count;
+        for (c = 0; c < count; c++)
+            g[c] += pow(xi[c] - 0.5, 2) - cos(20 * PISA_PI * (xi[c] - 0.5));
+    }
+    for (c = 0; c < count; c++)
+        g[c] = 100 * (k + g[c]);
+}
+
+/* g of DTLZ2, DTLZ4 and DTLZ5 for the last k variables, into 'g' */
+static void sphere_g(int count, const double *x, double *g)
+{
+    int i, c;
+    int n = number_decision_variables;
+    int k = n - dimension + 1;
+
+    for (c = 0; c < count; c++)
+        g[c] = 0;
+    for (i = n - k + 1; i <= n; i++)
+    {
+        const double *xi = x + (size_t) (i - 1) * count;
+        for (c = 0; c < count; c++)
+            g[c] += pow(xi[c] - 0.5, 2);
+    }
+}
+
+int batch_DTLZ1(int count, const double *x, double *f, double *work)
+{
+    int i, j, c;
+    int m = dimension;
+    double *g = work;
+
+    rastrigin_g(count, x, g);
+    for (i = 1; i <= m; i++)
+    {
+        double *fi = f + (size_t) (i - 1) * count;
+        for (c = 0; c < count; c++)
+            fi[c] = 0.5 * (1 + g[c]);
+        for (j = m - i; j >= 1; j--)
+        {
+            const double *xj = x + (size_t) (j - 1) * count;
+            for (c = 0; c < count; c++)
+                fi[c] *= xj[c];
+        }
+        if (i > 1)
+        {
+            const double *xj = x + (size_t) (m - i) * count;
+            for (c = 0; c < count; c++)
+                fi[c] *= 1 - xj[c];
+        }
+    }
+    return (0);
+}
+
+/* the DTLZ problems with a spherical front: g from rastrigin_g() if
+   'rastrigin' and from sphere_g() otherwise, the angles from the
+   decision variables (raised to the power 100 if 'power') */
+static int spherical_batch(int count, const double *x, double *f,
+                           double *work, int rastrigin, int power)
+{
+    int c;
+    double *g = work;
+    double *co = work + count;
+    double *si = co + (size_t) dimension * count;
+
+    if (rastrigin)
+        rastrigin_g(count, x, g);
+    else
+        sphere_g(count, x, g);
+    for (c = 0; c < count; c++)
+        g[c] = 1 + g[c];
+    angle_columns(count, x, NULL, power, co, si);
+    spherical_objectives(count, g, co, si, f);
+    return (0);
+}
+
+int batch_DTLZ2(int count, const double *x, double *f, double *work)
+{
+    return (spherical_batch(count, x, f, work, 0, 0));
+}
+
+int batch_DTLZ3(int count, const double *x, double *f, double *work)
+{
+    return (spherical_batch(count, x, f, work, 1, 0));
+}
+
+int batch_DTLZ4(int count, const double *x, double *f, double *work)
+{
+    return (spherical_batch(count, x, f, work, 0, 1));
+}
+
+/* DTLZ5 and DTLZ6, with g from sphere_g() or the sum of x^0.1 */
+static int degenerate_batch(int count, const double *x, double *f,
+                            double *work, int sixth)
+{
+    int i, c;
+    int n = number_decision_variables;
+    int m = dimension;
+    int k = n - m + 1;
+    double *g = work;
+    double *co = work + count;
+    double *si = co + (size_t) m * count;
+    double *theta = f; /* f is only written at the end */
+
+    if (sixth)
+    {
+        for (c = 0; c < count; c++)
+            g[c] = 0;
+        for (i = n - k + 1; i <= n; i++)
+        {
+            const double *xi = x + (size_t) (i - 1) * count;
+            for (c = 0; c < count; c++)
+                g[c] += pow(xi[c], 0.1);
+        }
+    }
+    else
+        sphere_g(count, x, g);
+
+    for (c = 0; c < count; c++)
+        theta[c] = x[c] * PISA_PI / 2;
+    for (i = 2; i <= m - 1; i++)
+    {
+        const double *xi = x + (size_t) (i - 1) * count;
+        double *ti = theta + (size_t) (i - 1) * count;
+        for (c = 0; c < count; c++)
+        {
+            double t = PISA_PI / (4 * (1 + g[c]));
+            ti[c] = t * (1 + 2 * g[c] * xi[c]);
+        }
+    }
+    angle_columns(count, x, theta, 0, co, si);
+    for (c = 0; c < count; c++)
+        g[c] = 1 + g[c];
+    spherical_objectives(count, g, co, si, f);
+    return (0);
+}
+
+int batch_DTLZ5(int count, const double *x, double *f, double *work)
+{
+    return (degenerate_batch(count, x, f, work, 0));
+}
+
+int batch_DTLZ6(int count, const double *x, double *f, double *work)
+{
+    return (degenerate_batch(count, x, f, work, 1));
+}
+
+int batch_DTLZ7(int count, const double *x, double *f, double *work)
+{
+    int i, j, c;
+    int n = number_decision_variables;
+    int m = dimension;
+    int k = n - m + 1;
+    double *g = work;
+    double *h = work + count;
+    double *fm = f + (size_t) (m - 1) * count;
+
+    for (c = 0; c < count; c++)
+        g[c] = 0;
+    for (i = n - k + 1; i <= n; i++)
+    {
+        const double *xi = x + (size_t) (i - 1) * count;
+        for (c = 0; c < count; c++)
+            g[c] += xi[c];
+    }
+    for (c = 0; c < count; c++)
+    {
+        g[c] = 1 + 9 * g[c] / k;
+        h[c] = 0;
+    }
+
+    for (j = 1; j <= m - 1; j++)
+    {
+        const double *xj = x + (size_t) (j - 1) * count;
+        double *fj = f + (size_t) (j - 1) * count;
+        for (c = 0; c < count; c++)
+        {
+            fj[c] = xj[c];
+            h[c] += xj[c] / (1 + g[c]) * (1 + sin(3 * PISA_PI * xj[c]));
+        }
+    }
+    for (c = 0; c < count; c++)
+        fm[c] = (1 + g[c]) * (m - h[c]);
+    return (0);
+}
+
+/* the ZDT problems: f1 from the first variable, g and h as in eval_ZDTX()
+   for X = 'which' */
+static int zdt_batch(int count, const double *x, double *f, double *work,
+                     int which)
+{
+    int i, c;
+    int n = number_decision_variables;
+    double *g = work;
+    double *f1 = f;
+    double *f2 = f + count;
+
+    assert(dimension == 2);
+    assert(number_decision_variables >= 2);
+
+    if (which == 6)
+        for (c = 0; c < count; c++)
+            f1[c] = 1 - exp(-4 * x[c]) * pow(sin(6 * PISA_PI * x[c]), 6);
+    else
+        memcpy(f1, x, count * sizeof(double));
+    for (c = 0; c < count; c++)
+        g[c] = 0;
+    for (i = 1; i < n; i++)
+    {
+        const double *xi = x + (size_t) i * count;
+        if (which == 4)
+            for (c = 0; c < count; c++)
+                g[c] += xi[c] * xi[c] - 10 * cos(4 * PISA_PI * xi[c]);
+        else
+            for (c = 0; c < count; c++)
+                g[c] += xi[c];
+    }
+
+    switch (which)
+    {
+    case 1:
+        for (c = 0; c < count; c++)
+        {
+            double gc = 1 + 9 * g[c] / (n-1);
+            f2[c] = gc * (1 - sqrt(f1[c] / gc));
+        }
+        break;
+    case 2:
+        for (c = 0; c < count; c++)
+        {
+            double gc = 1 + 9 * g[c] / (n-1);
+            f2[c] = gc * (1 - pow(f1[c] / gc, 2));
+        }
+        break;
+    case 3:
+        for (c = 0; c < count; c++)
+        {
+            double gc = 1 + 9 * g[c] / (n-1);
+            double h = 1 - sqrt(f1[c] / gc)
+                - (f1[c] / gc) * sin(10 * PISA_PI * f1[c]);
+            f2[c] = gc * h + 1;
+        }
+        break;
+    case 4:
+        for (c = 0; c < count; c++)
+        {
+            double gc = 1 + 10 * (n - 1) + g[c];
+            f2[c] = gc * (1 - sqrt(f1[c] / gc));
+        }
+        break;
+    default: /* 6 */
+        for (c = 0; c < count; c++)
+        {
+            double gc = 1 + 9 * pow(g[c] / (n-1), 0.25);
+            f2[c] = gc * (1 - pow(f1[c] / gc, 2));
+        }
+    }
+    return (0);
+}
+
+int batch_ZDT1(int count, const double *x, double *f, double *work)
+{
+    return (zdt_batch(count, x, f, work, 1));
+}
+
+int batch_ZDT2(int count, const double *x, double *f, double *work)
+{
+    return (zdt_batch(count, x, f, work, 2));
+}
+
+int batch_ZDT3(int count, const double *x, double *f, double *work)
+{
+    return (zdt_batch(count, x, f, work, 3));
+}
+
+int batch_ZDT4(int count, const double *x, double *f, double *work)
+{
+    return (zdt_batch(count, x, f, work, 4));
+}
+
+int batch_ZDT6(int count, const double *x, double *f, double *work)
+{
+    return (zdt_batch(count, x, f, work, 6));
+}
+
 /* create a random new individual and allocate memory for it,
    returns a pointer to the new individual */
 individual *new_individual()
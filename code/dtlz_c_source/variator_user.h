@@ -116,6 +116,19 @@ int state2();
 */
 
 
+int prepare_offspring();
+/* Called instead of waiting while the selector selects.
+
+   post: Optionally (steady state) the next 'lambda' children generated
+         from the parents read in the last state2(), added to the global
+         population and held with hold_individuals(), for the next
+         state2() to write them right away.
+         Return value == 0 if something was done,
+                      == 1 if unspecified errors happened,
+                      == 2 if there was nothing to do.
+*/
+
+
 int state4();
 /* Do what needs to be done in state 4.
 
@@ -175,9 +188,27 @@ int is_finished();
 
 /**********| added for DTLZ |**************/
 
+typedef int (*eval_function)(individual *ind);
+typedef int (*batch_function)(int count, const double *x, double *f,
+                              double *work);
+
+/* a test problem: its name, its evaluation function and its batch
+   kernel (NULL if it has none) */
+typedef struct problem_entry_t
+{
+     char *name;
+     eval_function eval;
+     batch_function batch;
+} problem_entry;
+
 int read_local_parameters();
 /* read local parameters from file */
 
+int steady_variate(int *parents, int *offspring);
+/* Steady state: returns the children prepare_offspring() made ready in
+   'offspring' and keeps 'parents' for the next ones.
+   Returns 0 if successful and 1 otherwise.*/
+
 individual *new_individual();
 
 individual *copy_individual(individual* ind);
@@ -199,6 +230,16 @@ double drand(double range);
 
 /* Determines the objective value. PISA always minimizes. */
 int eval(individual *p_ind);
+
+/* Determines the objective values of the 'count' individuals with the
+   IDs in 'identities', with one call of the batch kernel of the problem
+   if it has one. Returns 0 if successful and 1 otherwise. */
+int eval_batch(int count, int *identities);
+
+/* Sets 'eval_problem' and 'eval_problem_batch' to the functions of
+   'problem'. Returns 0 if successful and 1 if the problem is unknown. */
+int resolve_problem();
+
 int eval_DTLZ1(individual *p_ind);
 int eval_DTLZ2(individual *p_ind);
 int eval_DTLZ3(individual *p_ind);
@@ -216,6 +257,23 @@ int eval_SPHERE(individual *p_ind);
 int eval_KUR(individual *p_ind);
 int eval_QV(individual *p_ind);
 
+/* Batch kernels, see variator_user.c: the decision variables of 'count'
+   individuals in 'x' (variable i of individual c at i * count + c),
+   the objective values to 'f' (likewise), 'work' for
+   (2 * dimension + 1) * count doubles. */
+int batch_DTLZ1(int count, const double *x, double *f, double *work);
+int batch_DTLZ2(int count, const double *x, double *f, double *work);
+int batch_DTLZ3(int count, const double *x, double *f, double *work);
+int batch_DTLZ4(int count, const double *x, double *f, double *work);
+int batch_DTLZ5(int count, const double *x, double *f, double *work);
+int batch_DTLZ6(int count, const double *x, double *f, double *work);
+int batch_DTLZ7(int count, const double *x, double *f, double *work);
+int batch_ZDT1(int count, const double *x, double *f, double *work);
+int batch_ZDT2(int count, const double *x, double *f, double *work);
+int batch_ZDT3(int count, const double *x, double *f, double *work);
+int batch_ZDT4(int count, const double *x, double *f, double *work);
+int batch_ZDT6(int count, const double *x, double *f, double *work);
+
 void write_output_file();
 
 /**********| addition for DTLZ end |*******/
@@ -52,14 +52,23 @@ int current_max_size;
 /* starting array size of the individuals array in global_population,
    defined in variator_internal.c */
 
+int *held_ids = NULL; /* individuals read_arc() keeps as well, see */
+int held_count = 0;   /* hold_individuals() */
+
+static void set_file_names(char *filenamebase);
+
+static void empty_areas();
+
 
 /*-------------------------| main() |-----------------------------------*/
 
+#ifndef PISA_NO_MAIN /* defined when the variator is linked into another
+                        program, e.g. the driver */
 int main(int argc, char *argv[])
 {
-     FILE *fp;
-     int returncode; /* storing the values that the state functions return */
      int current_state = 0;
+     int next_state;
+     int returncode;
 
      char filenamebase[FILE_NAME_LENGTH_INTERNAL]; /* filename base,
                                                       e.g. "dir/test." */
@@ -81,12 +90,7 @@ int main(int argc, char *argv[])
      }
 
      /* generate file names based on 'filenamebase'*/
-     sprintf(var_file, "%svar", filenamebase);
-     sprintf(sel_file, "%ssel", filenamebase);
-     sprintf(cfg_file, "%scfg", filenamebase);
-     sprintf(ini_file, "%sini", filenamebase);
-     sprintf(arc_file, "%sarc", filenamebase);
-     sprintf(sta_file, "%ssta", filenamebase);
+     set_file_names(filenamebase);
 
 
      /* initializing global_population */
@@ -95,30 +99,27 @@ int main(int argc, char *argv[])
      global_population.last_identity = -1;
      
      
-     /* creating files and writing 0 in there */
-     fp = fopen(var_file, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
-     
-     fp = fopen(sel_file, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
-
-     fp = fopen(ini_file, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
-     
-     fp = fopen(arc_file, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
+     if (open_transport(filenamebase) != 0)
+     {
+          printf("Variator - cannot open the transport\n");
+          return (1);
+     }
+
+     if (transport != TRANSPORT_FILE) /* empty the areas */
+     {
+          empty_areas();
+     }
+     else /* creating files and writing 0 in there */
+     {
+          empty_file(var_file);
+          empty_file(sel_file);
+          empty_file(ini_file);
+          empty_file(arc_file);
+     }
      
-     /* state machine: uses the stateX() functions to do the steps required
-        in state X. Those state functions have to be implemented by 
-        the user in selector_user.c */
+     /* state machine: variator_step() uses the stateX() functions to do
+        the steps required in state X. Those state functions have to be
+        implemented by the user in variator_user.c */
      
      write_state(current_state);
      
@@ -128,123 +129,172 @@ int main(int argc, char *argv[])
      {
           current_state = read_state(); /* state == -1 if reading
                                                    fails */
-          if (current_state == 0)
-          {
-               read_common_parameters();
+          next_state = (current_state == 4) ? -1
+               : variator_step(current_state);
 
-               returncode = state0();
-               
-               if (returncode == 0)
-               {
-                  current_state = 1;
-                  write_state(current_state);     
-               }
-               
-               else if (returncode != 2)  /* error other then
-                                             file reading */
-               {
-                  state_error(0, __LINE__);
-               } /* else do nothing and read state again */
-          }
-          
-          else if (current_state == 2)
-          { 
-               if (is_finished()) /* checking termination criterion */
-               {
-                    current_state = 4; /* terminate */
-                    write_state(current_state);
-               }
-               else
-               {
-                    if (check_var() == 0)
-                    {
-                         returncode = state2();
-                         if (returncode == 0)/* if everything went ok set
-                                                state 3 */
-                         {
-                              del_sel(); /* all ok => delete content of */
-                              del_arc(); /* files. */
-                              current_state = 3; 
-                              write_state(current_state);
-                         }
-                         else if (returncode != 2)  /* error other then
-                                                       file reading */
-                         {
-                              state_error(2, __LINE__);
-                         } /* else do nothing and read state again */
-                    }
-               }
-          }
-          
-      
-          else if (current_state == 7) /* selector has just terminated;
-                                          do what you like ... */
-          { /* ... e.g. go to state 4, terminate as well */
-               returncode = state7();
-               if (returncode == 0)
-               {
-                    current_state = 4;
-                    write_state(current_state);
-               }
-               else if (returncode != 2)  /* error other then
-                                             file reading */
-               {
-                    state_error(7, __LINE__);
-               } /* else do nothing and read state again */
-          }
-      
-          else if (current_state == 8)
+          if (next_state == -1) /* no state which concerns variation */
           {
-               returncode = state8();
-               if (returncode == 0)
-               {
-                    current_state = 9;
-                    clean_population();
-                    write_state(current_state);
-               }
-               else if (returncode != 2)  /* error other then
-                                             file reading */
-               {
-                    state_error(8, __LINE__);
-               } /* else do nothing and read state again */
-               
+               /* while the selector selects, the next offspring may be
+                  made ready (steady state), once the monitor has
+                  fetched the last ones */
+               returncode = data_unfetched() ? 2 : prepare_offspring();
+               if (returncode == 1)
+                    state_error(current_state, __LINE__);
+               if (returncode != 0)
+                    wait(poll);
           }
+          else if (next_state != current_state)
+          {
+               current_state = next_state;
+               write_state(current_state);
+          } /* else do nothing and read state again */
+      
+     } /* state == 4 (stop) */
+
+     write_state(variator_step(4));
+     close_transport(1); /* the monitor may still read the state */
+     return (0);
+}
+#endif /* PISA_NO_MAIN */
+
+
+/*-------------------------| state machine |----------------------------*/
+
+static void set_file_names(char *filenamebase)
+/* Generates the file names based on 'filenamebase'. */
+{
+     sprintf(var_file, "%svar", filenamebase);
+     sprintf(sel_file, "%ssel", filenamebase);
+     sprintf(cfg_file, "%scfg", filenamebase);
+     sprintf(ini_file, "%sini", filenamebase);
+     sprintf(arc_file, "%sarc", filenamebase);
+     sprintf(sta_file, "%ssta", filenamebase);
+}
+
+
+static void empty_areas()
+/* Empties the areas of the segment, as main() does with the files. */
+{
+     set_shm_word(SHM_VAR, 0);
+     set_shm_word(SHM_SEL, 0);
+     set_shm_word(SHM_INI, 0);
+     set_shm_word(SHM_ARC, 0);
+}
+
+
+int variator_step(int state)
+/* Does the steps required in 'state' with the stateX() functions.
+   Returns the state to write next, 'state' if the step has to be tried
+   again (e.g. the files are not completely written yet) and -1 if
+   'state' does not concern the variator. Calls state_error() if a
+   state function fails. */
+{
+     int returncode; /* storing the values that the state functions return */
+
+     if (state == 0)
+     {
+          read_common_parameters();
+
+          returncode = state0();
+          if (returncode == 0)
+               return (1);
+          else if (returncode != 2)  /* error other then
+                                        file reading */
+               state_error(0, __LINE__);
+          return (state); /* else do nothing and read state again */
+     }
           
-          else if (current_state == 11) /* selector has resetted and is ready
-                                           to start again in state 0;
-                                           do what you like ... */
+     else if (state == 2)
+     { 
+          if (is_finished()) /* checking termination criterion */
+               return (4); /* terminate */
+          if (check_var() == 0)
           {
-               returncode = state11();
-               if (returncode == 0)
+               returncode = state2();
+               if (returncode == 0)/* if everything went ok set
+                                      state 3 */
                {
-                    current_state = 0;
-                    write_state(current_state);
+                    del_sel(); /* all ok => delete content of */
+                    del_arc(); /* files. */
+                    return (3);
                }
                else if (returncode != 2)  /* error other then
                                              file reading */
-               {
-                    state_error(11, __LINE__);
-               } /* else do nothing and read state again */
+                    state_error(2, __LINE__);
           }
-      
-          else /* no state which concerns variation */
+          return (state);
+     }
+
+     else if (state == 4) /* stop */
+     {
+          returncode = state4();
+          if (returncode == 0)
           {
-               wait(poll);
+               clean_population();
+               return (5);
           }
+          state_error(4, __LINE__);
+     }
       
-     } /* state == 4 (stop) */
-
-     returncode = state4();
-     if (returncode == 0)
+     else if (state == 7) /* selector has just terminated;
+                             do what you like ... */
+     { /* ... e.g. go to state 4, terminate as well */
+          returncode = state7();
+          if (returncode == 0)
+               return (4);
+          else if (returncode != 2)  /* error other then
+                                        file reading */
+               state_error(7, __LINE__);
+          return (state);
+     }
+      
+     else if (state == 8)
      {
-          clean_population();
-          current_state = 5;
-          write_state(current_state);
+          returncode = state8();
+          if (returncode == 0)
+          {
+               clean_population();
+               return (9);
+          }
+          else if (returncode != 2)  /* error other then
+                                        file reading */
+               state_error(8, __LINE__);
+          return (state);
      }
-     else
+          
+     else if (state == 11) /* selector has resetted and is ready
+                              to start again in state 0;
+                              do what you like ... */
      {
-          state_error(4, __LINE__);
+          returncode = state11();
+          if (returncode == 0)
+               return (0);
+          else if (returncode != 2)  /* error other then
+                                        file reading */
+               state_error(11, __LINE__);
+          return (state);
      }
+
+     return (-1);
+}
+
+
+int variator_open(char *param, char *filenamebase, void **memory)
+/* Sets up the variator as main() does, but for running in one program
+   with the selector (see driver_c_source): the state and the data are
+   exchanged through the segment '*memory' in the memory of the program
+   (see open_memory_transport()).
+   Returns 0 if successful and 1 otherwise. */
+{
+     strcpy(paramfile, param);
+     set_file_names(filenamebase);
+     global_population.individual_array = NULL;
+     global_population.size = 0;
+     global_population.last_identity = -1;
+     read_common_parameters();
+     if (open_memory_transport(memory) != 0)
+          return (1);
+     empty_areas();
      return (0);
 }
 
@@ -361,63 +411,13 @@ int get_size()
 /*-------------------------| io |---------------------------------------*/
 
 
-int read_arc()
-/* Reads 'arc' file, and automatically removes all individuals from
-   the global population which are not in the arc file. */
+static int keep_only(int *keep, int size)
+/* Removes all individuals from the global population whose IDs are
+   not among the 'size' IDs in 'keep', and frees 'keep'.
+   Returns 0 if successful and 1 otherwise. */
 {
-     int size, result; 
-     int *keep;
-     FILE *fp; 
-     char tag[4];
      int i, current;
-
-     fp = fopen(arc_file, "r");
-     assert(fp != NULL);
-     
-     /* read arc file and store indexes in keep array */
-     fscanf(fp, "%d", &size);
-     if(size <= 0) /* we need to keep at least one individual */
-     {
-          log_to_file(log_file, __FILE__, __LINE__, "size<=0 in arc file!");
-          fclose(fp);
-          return (1);
-     }
-
-     result = 0;
-     keep = (int *) malloc(sizeof(int)*size);
-
-     if (keep == NULL)
-     {
-          log_to_file(log_file, __FILE__, __LINE__, "variator out of memory");
-          fclose(fp);
-          return (1);
-     }  
-
-     for(i=0; i < size; i++)
-     {
-          result = fscanf(fp, "%d", &keep[i]);
-          if (result == EOF) /* fscanf() returns EOF if reading failed */
-          {
-               log_to_file(log_file, __FILE__, __LINE__,
-                           "EOF before END tag");
-               fclose(fp);
-               return (1);
-          } 
-     }
-
-     fscanf(fp, "%s", tag);
-
-     if (strcmp(tag, "END") != 0) /* no "END" here */
-     {
-          log_to_file(log_file, __FILE__, __LINE__, "no END tag");
-          fclose(fp);
-          return (1);
-     }
-     else /* "END" ok - all reading done*/
-     {
-          fclose(fp);
-          /* deleting content must be done after arc and sel file are read */
-     }
+     int result;
 
      /* sort the array of indexes to keep,
         so we can go through the array and delete all indexes,
@@ -463,14 +463,88 @@ int read_arc()
 }
 
 
+static int keep_ids(int *ids, int size)
+/* Removes all individuals from the global population whose IDs are
+   not among the 'size' IDs in 'ids' or held (see hold_individuals()).
+   Returns 0 if successful and 1 otherwise. */
+{
+     int *keep;
+
+     if (size <= 0) /* we need to keep at least one individual */
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "size<=0 in archive!");
+          return (1);
+     }
+     keep = (int *) malloc(sizeof(int) * (size + held_count));
+     if (keep == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "variator out of memory");
+          return (1);
+     }
+     memcpy(keep, ids, sizeof(int) * size);
+     if (held_count > 0)
+          memcpy(keep + size, held_ids, sizeof(int) * held_count);
+     return (keep_only(keep, size + held_count));
+}
+
+
+int read_arc()
+/* Reads 'arc' file, and automatically removes all individuals from
+   the global population which are not in the arc file. */
+{
+     int result;
+     binary_data data;
+
+     if (transport != TRANSPORT_FILE)
+          return (keep_ids(shm_ids(SHM_ARC), get_shm_word(SHM_ARC)));
+
+     if (read_data(arc_file, 0, &data) != 0)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "arc file incomplete");
+          return (1);
+     }
+     result = keep_ids(data.ids, data.count);
+     free(data.buffer);
+     /* deleting content must be done after arc and sel file are read */
+     return (result);
+}
+
+
+int hold_individuals(int *identity, int size)
+/* Makes read_arc() keep the 'size' individuals with the IDs in
+   'identity' as well, until it is called again ('size' 0 releases
+   them). This is for offspring the selector has not seen yet.
+   Returns 0 if successful and 1 otherwise. */
+{
+     int *ids = NULL;
+
+     if (size > 0)
+     {
+          ids = (int *) malloc(sizeof(int) * size);
+          if (ids == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "variator out of memory");
+               return (1);
+          }
+          memcpy(ids, identity, sizeof(int) * size);
+     }
+     free(held_ids);
+     held_ids = ids;
+     held_count = size;
+     return (0);
+}
+
+
 void del_arc()
 /* Deletes the content of the arc file. */
 {
-   FILE *fp;
-   fp = fopen(arc_file, "w");
-   assert(fp != NULL);
-   fprintf(fp, "%d", 0);
-   fclose(fp);
+   if (transport != TRANSPORT_FILE)
+   {
+        set_shm_word(SHM_ARC, 0);
+        return;
+   }
+   empty_file(arc_file);
 }
 
 
@@ -484,38 +558,39 @@ int read_sel(int *id_array)
    If reading is successful function returns 0, otherwise it returns
    1. */
 {
-     int size, result; 
-     FILE *fp; 
-     char tag[4];
-     int i;
+     int size; 
+     binary_data data;
 
      assert(id_array != NULL);
      
-     fp = fopen(sel_file, "r");
-     assert(fp != NULL);
-     /* read sel file and store indexes in 'id_array' */
-     fscanf(fp, "%d", &size);
-     result = 0;
-
-     for(i = 0; i < size; i++)
+     if (transport != TRANSPORT_FILE)
      {
-          result = fscanf(fp, "%d", &id_array[i]);
-          if (result == EOF) /* fscanf() returns EOF if reading failed */
+          size = get_shm_word(SHM_SEL);
+          if (size <= 0 || size > mu)
           {
                log_to_file(log_file, __FILE__, __LINE__,
-                           "EOF reached before array filled");
-               fclose(fp);
+                           "wrong number of parents in shared memory");
                return (1);
-          } 
+          }
+          memcpy(id_array, shm_ids(SHM_SEL), sizeof(int) * size);
+          return (0);
      }
-     fscanf(fp, "%s", tag);
-     if (strcmp(tag, "END") != 0) /* "END" not found */
+
+     if (read_data(sel_file, 0, &data) != 0)
      {
-          log_to_file(log_file, __FILE__, __LINE__, "couldn't find END tag");
-          fclose(fp);
+          log_to_file(log_file, __FILE__, __LINE__, "sel file incomplete");
+          return (1);
+     }
+     size = data.count;
+     if (size > mu)
+     {
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "too many parents in sel file");
+          free(data.buffer);
           return (1);
      }
-     fclose(fp);
+     memcpy(id_array, data.ids, sizeof(int) * size);
+     free(data.buffer);
      
      /* deleting content must be done after arc file properly read*/
      
@@ -526,11 +601,53 @@ int read_sel(int *id_array)
 void del_sel()
 /* Delete content of the sel file. */
 {
-   FILE *fp;
-   fp = fopen(sel_file, "w");
-   assert(fp != NULL);
-   fprintf(fp, "%d", 0);
-   fclose(fp);
+   if (transport != TRANSPORT_FILE)
+   {
+        set_shm_word(SHM_SEL, 0);
+        return;
+   }
+   empty_file(sel_file);
+}
+
+
+static void write_shm_records(int area, int count, int *identity)
+/* Writes the 'count' individuals in 'identity' to 'area' (SHM_INI or
+   SHM_VAR) of the shared memory segment. */
+{
+     int *ids = shm_ids(area);
+     double *values = shm_values(area);
+     int i, j;
+
+     for (i = 0; i < count; i++)
+     {
+          ids[i] = identity[i];
+          for (j = 0; j < dimension; j++)
+               values[i * dimension + j] = get_objective_value(identity[i], j);
+     }
+     set_shm_word(area, count);
+}
+
+
+static int write_binary_records(char *filename, int count, int *identity)
+/* Writes the 'count' individuals in 'identity' to 'filename' in the
+   binary format. Returns 0 if successful and 1 otherwise. */
+{
+     binary_data data;
+     int i, j;
+
+     if (new_binary(&data, count, dimension) != 0)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "variator out of memory");
+          return (1);
+     }
+     for (i = 0; i < count; i++)
+     {
+          data.ids[i] = identity[i];
+          for (j = 0; j < dimension; j++)
+               data.values[i * dimension + j] =
+                    get_objective_value(identity[i], j);
+     }
+     return (write_binary(filename, &data));
 }
 
 
@@ -559,8 +676,17 @@ int write_ini(int *identity)
           } 
      }
 
-     fp = fopen(ini_file, "w");
-     assert(fp != NULL);
+     if (transport != TRANSPORT_FILE)
+     {
+          write_shm_records(SHM_INI, alpha, identity);
+          return (0);
+     }
+     if (format == FORMAT_BINARY)
+          return (write_binary_records(ini_file, alpha, identity));
+
+     fp = begin_file(ini_file);
+     if (fp == NULL)
+          return (1);
      fprintf(fp, "%d\n", (alpha * (dimension + 1)));
      for (i = 0; i < alpha; i++)
      {
@@ -570,8 +696,7 @@ int write_ini(int *identity)
           fprintf(fp, "\n");
      }
      fprintf(fp, "END");
-     fclose(fp);
-     return (0);
+     return (publish_file(fp, ini_file));
 }
 
 
@@ -600,8 +725,17 @@ int write_var(int *identity)
           } 
      }
 
-     fp = fopen(var_file, "w");
-     assert(fp != NULL);
+     if (transport != TRANSPORT_FILE)
+     {
+          write_shm_records(SHM_VAR, lambda, identity);
+          return (0);
+     }
+     if (format == FORMAT_BINARY)
+          return (write_binary_records(var_file, lambda, identity));
+
+     fp = begin_file(var_file);
+     if (fp == NULL)
+          return (1);
      fprintf(fp, "%d\n", (lambda * (dimension+1)));  
      for (i = 0; i < lambda; i++)
      {
@@ -611,8 +745,7 @@ int write_var(int *identity)
           fprintf(fp, "\n");
      }
      fprintf(fp, "END");
-     fclose(fp);
-     return (0);
+     return (publish_file(fp, var_file));
 }
 
 
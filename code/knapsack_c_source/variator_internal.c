@@ -35,6 +35,32 @@
 /* this is needed for the wait function */
 #ifdef PISA_UNIX
 #include <unistd.h>
+#ifdef __linux__
+#define PISA_INOTIFY /* wait() wakes up when the state file is written */
+#include <sys/select.h>
+#include <time.h>
+#include <sys/inotify.h>
+#define PISA_FUTEX /* the shared memory transport waits on a futex */
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#define PISA_SHM /* POSIX shared memory for 'transport shm' */
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define PISA_SOCKET /* stream sockets for 'transport socket' */
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <time.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 #endif
 
 #ifdef PISA_WIN
@@ -65,6 +91,919 @@ char sta_file[FILE_NAME_LENGTH_INTERNAL];
 
 population global_population; /* pool of all existing individuals */
 
+int transport = TRANSPORT_FILE; /* set by open_transport() */
+int format = FORMAT_TEXT; /* set from the cfg file */
+
+/*--------------------| shared memory transport |-----------------------*/
+
+#define SHM_MAGIC 0x50495341 /* "PISA", set once the segment is set up */
+
+/* beginning of the segment; the areas of records follow */
+typedef struct shm_header_t
+{
+     int magic;           /* SHM_MAGIC */
+     int dimension;       /* number of objective values per record */
+     int capacity;        /* number of records per area */
+     int sequence;        /* incremented on every change of 'word' */
+     int word[SHM_WORDS]; /* state and number of records in each area */
+} shm_header;
+
+static shm_header *segment = NULL; /* attached segment */
+
+static int seen_sequence; /* 'sequence' when the state was last read */
+
+static int cfg_transport = TRANSPORT_FILE; /* asked for in the cfg file */
+
+static char socket_address[CFG_ENTRY_LENGTH_INTERNAL]; /* from the cfg file,
+                                                        for the sockets */
+static int listen_fd = -1; /* socket the monitor connects to */
+
+static int peer_fd = -1; /* connection with the monitor, -1 if none */
+
+static int wait_value = -1; /* state the monitor waits to change, -1 if
+                               it does not wait */
+
+static int var_unfetched = 0; /* 1 from writing var until the monitor
+                                 has fetched it */
+
+
+static int open_socket();
+
+
+static size_t header_bytes()
+/* Returns the size of the header, rounded up for the doubles. */
+{
+     return ((sizeof(shm_header) + 7) / 8 * 8);
+}
+
+
+static size_t ids_bytes(int capacity)
+/* Returns the size of the IDs of an area, rounded up for the doubles. */
+{
+     return ((capacity * sizeof(int) + 7) / 8 * 8);
+}
+
+
+static size_t area_bytes(int capacity)
+/* Returns the size of an area. */
+{
+     return (ids_bytes(capacity) + capacity * dimension * sizeof(double));
+}
+
+
+static char *area_start(shm_header *header, int area)
+/* Returns the start of 'area' (SHM_INI ... SHM_ARC) in 'header'. */
+{
+     return ((char *) header + header_bytes()
+             + (area - 1) * area_bytes(header->capacity));
+}
+
+
+static void wake_waiters(shm_header *header)
+/* Tells the processes waiting on 'header' that a word has changed. */
+{
+     __atomic_add_fetch(&header->sequence, 1, __ATOMIC_RELEASE);
+#ifdef PISA_FUTEX
+     syscall(SYS_futex, &header->sequence, FUTEX_WAKE, INT_MAX, NULL, NULL,
+             0);
+#endif
+}
+
+
+#ifdef PISA_SHM
+
+static int segment_name(char *filenamebase, char *name)
+/* Writes the name of the segment of 'filenamebase' to 'name', a hash
+   of the absolute path of 'filenamebase'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char dir[FILE_NAME_LENGTH_INTERNAL];
+     char path[PATH_MAX];
+     char *slash = strrchr(filenamebase, '/');
+     char *base = (slash == NULL) ? filenamebase : slash + 1;
+     unsigned long long hash = 14695981039346656037ULL; /* FNV-1a */
+     char *p;
+
+     if (slash == NULL)
+          strcpy(dir, ".");
+     else if (slash == filenamebase)
+          strcpy(dir, "/");
+     else
+     {
+          strncpy(dir, filenamebase, slash - filenamebase);
+          dir[slash - filenamebase] = '\0';
+     }
+     if (realpath(dir, path) == NULL)
+          return (1);
+     strcat(path, "/");
+     for (p = path; *p != '\0'; p++)
+          hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+     for (p = base; *p != '\0'; p++)
+          hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+     sprintf(name, "/pisa-%016llx", hash);
+     return (0);
+}
+
+
+static shm_header *attach_segment(char *filenamebase, int capacity)
+/* Maps the segment of 'filenamebase', and creates it for 'capacity'
+   records per area if it does not exist yet.
+   Returns NULL if this fails, e.g. for a segment left behind with
+   another layout. */
+{
+     char name[32];
+     size_t size = header_bytes() + (SHM_WORDS - 1) * area_bytes(capacity);
+     struct stat st;
+     shm_header *header;
+     int fd, i;
+     int created = 1;
+
+     if (segment_name(filenamebase, name) != 0)
+          return (NULL);
+     fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+     if (fd < 0 && errno == EEXIST)
+     {
+          created = 0;
+          fd = shm_open(name, O_RDWR, 0600);
+     }
+     if (fd < 0)
+          return (NULL);
+     if (created && ftruncate(fd, size) != 0)
+     {
+          close(fd);
+          shm_unlink(name);
+          return (NULL);
+     }
+     /* the process creating the segment may not have sized it yet */
+     for (i = 0; !created && i < 1000; i++)
+     {
+          if (fstat(fd, &st) != 0 || st.st_size >= (off_t) size)
+               break;
+          usleep(1000);
+     }
+     if (!created && (fstat(fd, &st) != 0 || st.st_size != (off_t) size))
+     {
+          close(fd);
+          return (NULL);
+     }
+     header = (shm_header *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, fd, 0);
+     close(fd);
+     if (header == MAP_FAILED)
+          return (NULL);
+
+     if (created) /* ftruncate() has set all words to 0 */
+     {
+          header->dimension = dimension;
+          header->capacity = capacity;
+          __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+     }
+     for (i = 0; i < 1000; i++)
+     {
+          if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC)
+               break;
+          usleep(1000);
+     }
+     if (header->magic != SHM_MAGIC || header->dimension != dimension
+         || header->capacity != capacity)
+     {
+          munmap(header, size);
+          return (NULL);
+     }
+     return (header);
+}
+
+#endif
+
+
+static int wait_for_change(double sec)
+/* Sleeps until a word of the segment changes after the state was last
+   read, but at most 'sec' seconds.
+   Returns 0 if it waited and 1 if futexes are not available. */
+{
+#ifdef PISA_FUTEX
+     struct timespec timeout;
+
+     timeout.tv_sec = (time_t) floor(sec);
+     timeout.tv_nsec = (long) ((sec - floor(sec)) * 1e9);
+     syscall(SYS_futex, &segment->sequence, FUTEX_WAIT, seen_sequence,
+             &timeout, NULL, 0);
+     return (0);
+#else
+     return (1);
+#endif
+}
+
+
+static int read_shm_state()
+/* Reads the state from the segment. */
+{
+     seen_sequence = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+     return (get_shm_word(SHM_STA));
+}
+
+
+int open_transport(char *filenamebase)
+/* Reads the cfg file, if it exists yet, and attaches the shared memory
+   segment of 'filenamebase' if it asks for 'transport shm'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     FILE *fp;
+
+     fp = fopen(cfg_file, "r");
+     if (fp == NULL)
+          return (0); /* stay with the files */
+     fclose(fp);
+     read_common_parameters();
+     if (cfg_transport == TRANSPORT_SOCKET)
+          return (open_socket());
+     if (cfg_transport != TRANSPORT_SHM)
+          return (0);
+
+#ifdef PISA_SHM
+     segment = attach_segment(filenamebase, alpha + mu + lambda);
+#endif
+     if (segment == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "cannot attach shared memory segment");
+          return (1);
+     }
+     transport = TRANSPORT_SHM;
+     return (0);
+}
+
+
+int open_memory_transport(void **memory)
+/* Switches to the shared memory transport on a segment in the memory
+   of this process, for running in one program with the selector: on a
+   new segment, stored in '*memory', if '*memory' is NULL, and on the
+   segment '*memory' otherwise.
+   Returns 0 if successful and 1 otherwise. */
+{
+     int capacity = alpha + mu + lambda;
+     shm_header *header = (shm_header *) *memory;
+
+     if (header == NULL)
+     {
+          header = (shm_header *) calloc(1, header_bytes()
+                                         + (SHM_WORDS - 1)
+                                         * area_bytes(capacity));
+          if (header == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "cannot allocate segment");
+               return (1);
+          }
+          header->magic = SHM_MAGIC;
+          header->dimension = dimension;
+          header->capacity = capacity;
+          *memory = header;
+     }
+     if (header->magic != SHM_MAGIC || header->dimension != dimension
+         || header->capacity != capacity)
+     {
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "segment with another layout");
+          return (1);
+     }
+     segment = header;
+     transport = TRANSPORT_SHM;
+     return (0);
+}
+
+
+int get_shm_word(int word)
+/* Returns the word 'word' (SHM_STA ... SHM_ARC) of the segment. */
+{
+     return (__atomic_load_n(&segment->word[word], __ATOMIC_ACQUIRE));
+}
+
+
+void set_shm_word(int word, int value)
+/* Sets the word 'word' of the segment and wakes up the processes
+   waiting for a change. */
+{
+     __atomic_store_n(&segment->word[word], value, __ATOMIC_RELEASE);
+     wake_waiters(segment);
+}
+
+
+int shm_capacity()
+/* Returns the number of records an area can hold. */
+{
+     return (segment->capacity);
+}
+
+
+int *shm_ids(int area)
+/* Returns the IDs of the records in 'area'. */
+{
+     return ((int *) area_start(segment, area));
+}
+
+
+double *shm_values(int area)
+/* Returns the objective values of the records in 'area'. */
+{
+     return ((double *) (area_start(segment, area)
+                         + ids_bytes(segment->capacity)));
+}
+
+
+/*-------------------------| socket transport |-------------------------*/
+
+#ifdef PISA_SOCKET
+
+static int module_address(char *address, char *role, char *result)
+/* Writes the address on which the module 'role' ("variator" or
+   "selector") listens to 'result' (CFG_ENTRY_LENGTH_INTERNAL
+   characters): for the path of a Unix domain socket 'address' followed
+   by '.' and 'role', for 'host:port' the port itself for the variator
+   and the next one for the selector. The two modules of a run thus
+   never share an address, even with the same cfg file.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char *colon = strrchr(address, ':');
+     char *end;
+     long port;
+     int length;
+
+     if (colon == NULL)
+          length = snprintf(result, CFG_ENTRY_LENGTH_INTERNAL, "%s.%s",
+                            address, role);
+     else
+     {
+          port = strtol(colon + 1, &end, 10);
+          if (end == colon + 1 || *end != '\0' || port < 1 || port > 65534)
+               return (1);
+          if (strcmp(role, "selector") == 0)
+               port++;
+          length = snprintf(result, CFG_ENTRY_LENGTH_INTERNAL, "%.*s:%ld",
+                            (int) (colon - address), address, port);
+     }
+     return (length < 0 || length >= CFG_ENTRY_LENGTH_INTERNAL);
+}
+
+
+static int listen_on(char *address)
+/* Returns a socket listening on 'address', 'host:port' or the path of a
+   Unix domain socket, or -1 if this fails, e.g. because another process
+   listens on it. */
+{
+     struct sockaddr_un local;
+     struct addrinfo hints, *list, *p;
+     char host[CFG_ENTRY_LENGTH_INTERNAL];
+     char *colon = strrchr(address, ':');
+     int fd = -1;
+     int on = 1;
+
+     if (colon == NULL) /* Unix domain socket */
+     {
+          if (strlen(address) >= sizeof(local.sun_path))
+               return (-1);
+          memset(&local, 0, sizeof(local));
+          local.sun_family = AF_UNIX;
+          strcpy(local.sun_path, address);
+          /* remove a socket left behind by an earlier run, but not one
+             another process still listens on */
+          fd = socket(AF_UNIX, SOCK_STREAM, 0);
+          if (fd >= 0 && connect(fd, (struct sockaddr *) &local,
+                                 sizeof(local)) == 0)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "socket address in use by another process");
+               close(fd);
+               return (-1);
+          }
+          if (fd >= 0 && errno == ECONNREFUSED)
+               unlink(address);
+          if (fd >= 0)
+               close(fd);
+          fd = socket(AF_UNIX, SOCK_STREAM, 0);
+          if (fd >= 0 && (bind(fd, (struct sockaddr *) &local,
+                               sizeof(local)) != 0 || listen(fd, 1) != 0))
+          {
+               close(fd);
+               fd = -1;
+          }
+          return (fd);
+     }
+
+     strncpy(host, address, colon - address);
+     host[colon - address] = '\0';
+     memset(&hints, 0, sizeof(hints));
+     hints.ai_family = AF_UNSPEC;
+     hints.ai_socktype = SOCK_STREAM;
+     hints.ai_flags = AI_PASSIVE;
+     if (getaddrinfo((host[0] == '\0') ? NULL : host, colon + 1, &hints,
+                     &list) != 0)
+          return (-1);
+     for (p = list; p != NULL && fd < 0; p = p->ai_next)
+     {
+          fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+          if (fd < 0)
+               continue;
+          setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+          if (bind(fd, p->ai_addr, p->ai_addrlen) != 0 || listen(fd, 1) != 0)
+          {
+               close(fd);
+               fd = -1;
+          }
+     }
+     freeaddrinfo(list);
+     return (fd);
+}
+
+
+static int send_all(int fd, void *buffer, size_t size)
+/* Writes 'size' bytes from 'buffer' to the socket 'fd'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char *p = (char *) buffer;
+     ssize_t n;
+
+     while (size > 0)
+     {
+          n = send(fd, p, size, MSG_NOSIGNAL);
+          if (n < 0 && errno == EINTR)
+               continue;
+          if (n <= 0)
+               return (1);
+          p += n;
+          size -= n;
+     }
+     return (0);
+}
+
+
+static int recv_all(int fd, void *buffer, size_t size)
+/* Reads 'size' bytes from the socket 'fd' into 'buffer'.
+   Returns 0 if successful and 1 otherwise (e.g. the peer closed the
+   connection). */
+{
+     char *p = (char *) buffer;
+     ssize_t n;
+
+     while (size > 0)
+     {
+          n = recv(fd, p, size, 0);
+          if (n < 0 && errno == EINTR)
+               continue;
+          if (n <= 0)
+               return (1);
+          p += n;
+          size -= n;
+     }
+     return (0);
+}
+
+
+static int transfer_records(int word, int count, int sending)
+/* Sends the 'count' records of the area of 'word' to the monitor, or
+   receives them into the area if 'sending' is 0. The state has none.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char *ids;
+     char *values;
+     size_t values_size = 0;
+
+     if (word == SHM_STA || count == 0)
+          return (0);
+     if (count < 0 || count > segment->capacity)
+          return (1);
+     ids = (char *) shm_ids(word);
+     values = (char *) shm_values(word);
+     if (word == SHM_INI || word == SHM_VAR)
+          values_size = (size_t) count * dimension * sizeof(double);
+     if (sending)
+          return (send_all(peer_fd, ids, count * sizeof(int))
+                  || send_all(peer_fd, values, values_size));
+     return (recv_all(peer_fd, ids, count * sizeof(int))
+             || recv_all(peer_fd, values, values_size));
+}
+
+
+static void answer_wait(int always)
+/* Answers the monitor waiting for the state to change, if it does and
+   the state has changed (or in any case if 'always'). */
+{
+     int message[4] = {SOCKET_MAGIC, SOCKET_WAIT, SHM_STA, 0};
+
+     message[3] = get_shm_word(SHM_STA);
+     if (wait_value < 0 || peer_fd < 0
+         || (message[3] == wait_value && !always))
+          return;
+     wait_value = -1;
+     if (send_all(peer_fd, message, sizeof(message)) != 0)
+     {
+          close(peer_fd);
+          peer_fd = -1;
+     }
+}
+
+
+static int handle_request()
+/* Answers one request of the monitor. Returns the word it has set, -1
+   for a GET or WAIT and -2 if the connection is closed or broken. */
+{
+     int message[4]; /* magic, request, word, value */
+     int word;
+
+     if (recv_all(peer_fd, message, sizeof(message)) != 0
+         || message[0] != SOCKET_MAGIC
+         || message[2] < 0 || message[2] >= SHM_WORDS)
+          return (-2);
+     word = message[2];
+     if (message[1] == SOCKET_WAIT && word == SHM_STA
+         && get_shm_word(SHM_STA) == message[3])
+     {
+          wait_value = message[3]; /* answered by answer_wait() */
+          return (-1);
+     }
+     if (message[1] == SOCKET_GET || message[1] == SOCKET_WAIT)
+     {
+          message[3] = get_shm_word(word);
+          if (send_all(peer_fd, message, sizeof(message)) != 0
+              || transfer_records(word, message[3], 1) != 0)
+               return (-2);
+          if (word == SHM_VAR)
+               var_unfetched = 0;
+          return (-1);
+     }
+     if (message[1] != SOCKET_SET || transfer_records(word, message[3], 0))
+          return (-2);
+     set_shm_word(word, message[3]);
+     return (word);
+}
+
+
+static int serve_peer(double sec)
+/* Answers the requests of the monitor, accepting its connection first
+   if needed, until it sets the state or fetches the var data written
+   last, but at most 'sec' seconds; with 'sec' 0 only the requests
+   already there. Returns 0 if the state was set or the data fetched and
+   1 otherwise (time is up or the connection has been closed). */
+{
+     struct timespec now, end;
+     struct timeval timeout;
+     fd_set fds;
+     long usec;
+     int fd, word;
+     int on = 1;
+     int unfetched = var_unfetched;
+
+     clock_gettime(CLOCK_MONOTONIC, &end);
+     end.tv_sec += (time_t) floor(sec);
+     end.tv_nsec += (long) ((sec - floor(sec)) * 1e9);
+     if (end.tv_nsec >= 1000000000L)
+     {
+          end.tv_sec++;
+          end.tv_nsec -= 1000000000L;
+     }
+     while (1)
+     {
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          usec = (end.tv_sec - now.tv_sec) * 1000000L
+               + (end.tv_nsec - now.tv_nsec + 999) / 1000;
+          if (usec < 0)
+               usec = 0;
+          timeout.tv_sec = usec / 1000000L;
+          timeout.tv_usec = usec % 1000000L;
+          if (peer_fd >= 0 && wait_value >= 0)
+          {
+               /* the monitor waits for this process to change the
+                  state and sends nothing meanwhile */
+               select(0, NULL, NULL, NULL, &timeout);
+               return (1);
+          }
+          fd = (peer_fd >= 0) ? peer_fd : listen_fd;
+          FD_ZERO(&fds);
+          FD_SET(fd, &fds);
+          if (select(fd + 1, &fds, NULL, NULL, &timeout) <= 0)
+               return (1); /* time is up (or interrupted) */
+          if (peer_fd < 0)
+          {
+               peer_fd = accept(listen_fd, NULL, NULL);
+               if (peer_fd >= 0) /* no effect on Unix domain sockets */
+                    setsockopt(peer_fd, IPPROTO_TCP, TCP_NODELAY, &on,
+                               sizeof(on));
+               continue;
+          }
+          word = handle_request();
+          if (word == -2)
+          {
+               close(peer_fd);
+               peer_fd = -1;
+               return (1);
+          }
+          if (word == SHM_STA || (unfetched && !var_unfetched))
+               return (0);
+     }
+}
+
+#endif
+
+
+static int open_socket()
+/* Sets up the words and areas in the memory of this process and
+   listens for the monitor on the address of this module derived from
+   'socket_address' (see module_address()).
+   Returns 0 if successful and 1 otherwise. */
+{
+     void *memory = NULL;
+
+#ifdef PISA_SOCKET
+     char address[CFG_ENTRY_LENGTH_INTERNAL];
+
+     if (module_address(socket_address, "variator", address) == 0)
+          listen_fd = listen_on(address);
+     if (listen_fd >= 0 && open_memory_transport(&memory) == 0)
+     {
+          transport = TRANSPORT_SOCKET;
+          return (0);
+     }
+     if (listen_fd >= 0)
+          close(listen_fd);
+     listen_fd = -1;
+#endif
+     log_to_file(log_file, __FILE__, __LINE__,
+                 "cannot listen on the socket address");
+     return (1);
+}
+
+
+int data_unfetched()
+/* Returns 1 if the monitor has not fetched the var data written last
+   over the socket transport yet and 0 otherwise. */
+{
+     return (var_unfetched);
+}
+
+
+int close_transport(int block)
+/* With the socket transport, answers the monitor until it closes the
+   connection (only the requests already there if 'block' is 0), and
+   then closes the sockets.
+   Returns 0 once the sockets are closed and 1 otherwise. */
+{
+#ifdef PISA_SOCKET
+     if (transport != TRANSPORT_SOCKET || listen_fd < 0)
+          return (0);
+     answer_wait(1); /* the state does not change any more */
+     while (peer_fd >= 0)
+          if (serve_peer(block ? 60 : 0) != 0 && !block)
+               break;
+     if (peer_fd >= 0)
+          return (1);
+     close(listen_fd);
+     listen_fd = -1;
+#endif
+     return (0);
+}
+
+
+/*-------------------------| data files |-------------------------------*/
+
+static void temp_name(char *filename, char *temp)
+/* Writes the name of the temporary file for 'filename' to 'temp'. */
+{
+     sprintf(temp, "%s.tmp", filename);
+}
+
+
+FILE *begin_file(char *filename)
+/* Opens the temporary file for writing the new content of 'filename'.
+   Returns NULL if this fails. */
+{
+     char temp[FILE_NAME_LENGTH_INTERNAL + 4];
+
+     temp_name(filename, temp);
+     return (fopen(temp, "wb"));
+}
+
+
+int publish_file(FILE *fp, char *filename)
+/* Closes 'fp', opened by begin_file(), and renames it to 'filename', so
+   readers see either the previous or the whole new content.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char temp[FILE_NAME_LENGTH_INTERNAL + 4];
+     int result = 0;
+
+     temp_name(filename, temp);
+     if (fflush(fp) != 0)
+          result = 1;
+#if defined(PISA_UNIX) && defined(PISA_FSYNC)
+     if (result == 0 && fsync(fileno(fp)) != 0)
+          result = 1;
+#endif
+     if (fclose(fp) != 0)
+          result = 1;
+#ifdef PISA_WIN
+     remove(filename); /* rename() does not replace files on Windows */
+#endif
+     if (result == 0 && rename(temp, filename) != 0)
+          result = 1;
+     if (result != 0)
+          remove(temp);
+     return (result);
+}
+
+
+void empty_file(char *filename)
+/* Leaves only '0' in the file 'filename'. */
+{
+     FILE *fp;
+     int result;
+
+     fp = begin_file(filename);
+     assert(fp != NULL);
+     fprintf(fp, "%d", 0);
+     result = publish_file(fp, filename);
+     assert(result == 0);
+}
+
+
+static char *read_file(char *filename, size_t *size)
+/* Reads the whole file 'filename' with a single read into a buffer
+   terminated by '\0' and stores its size in 'size'.
+   Returns NULL if this fails. */
+{
+     FILE *fp;
+     long length = -1;
+     char *buffer = NULL;
+
+     fp = fopen(filename, "rb");
+     if (fp == NULL)
+          return (NULL);
+     setvbuf(fp, NULL, _IONBF, 0); /* no copy into a stdio buffer */
+     if (fseek(fp, 0, SEEK_END) == 0)
+          length = ftell(fp);
+     if (length >= 0 && fseek(fp, 0, SEEK_SET) == 0)
+          buffer = (char *) malloc(length + 1);
+     if (buffer != NULL)
+     {
+          *size = fread(buffer, 1, length, fp);
+          buffer[*size] = '\0';
+     }
+     fclose(fp);
+     return (buffer);
+}
+
+
+/*-------------------------| binary files |-----------------------------*/
+
+#define BINARY_MAGIC "PISB" /* no digit, so check_*() see a full file */
+
+#define BINARY_HEADER 16 /* bytes before the IDs */
+
+
+static size_t binary_ids_bytes(int count)
+/* Returns the size of 'count' IDs, rounded up for the doubles. */
+{
+     return ((count * sizeof(int) + 7) / 8 * 8);
+}
+
+
+static int little_endian()
+/* Returns 1 if this host stores numbers little-endian, as the binary
+   format does, and 0 otherwise. */
+{
+     int one = 1;
+     return (*(char *) &one == 1);
+}
+
+
+int new_binary(binary_data *data, int count, int dimension)
+/* Allocates the buffer of 'data' for 'count' records and sets up the
+   header. Returns 0 if successful and 1 otherwise. */
+{
+     int header[3];
+
+     data->count = count;
+     data->dimension = dimension;
+     data->size = BINARY_HEADER + binary_ids_bytes(count)
+          + (size_t) count * dimension * sizeof(double);
+     data->buffer = (char *) calloc(data->size, 1);
+     if (data->buffer == NULL)
+          return (1);
+     header[0] = count;
+     header[1] = dimension;
+     header[2] = 0;
+     memcpy(data->buffer, BINARY_MAGIC, 4);
+     memcpy(data->buffer + 4, header, sizeof(header));
+     data->ids = (int *) (data->buffer + BINARY_HEADER);
+     data->values = (double *) (data->buffer + BINARY_HEADER
+                                + binary_ids_bytes(count));
+     return (0);
+}
+
+
+int write_binary(char *filename, binary_data *data)
+/* Writes 'data' to 'filename' with a single write, through
+   begin_file() and publish_file(), and frees its buffer.
+   Returns 0 if successful and 1 otherwise. */
+{
+     FILE *fp;
+     size_t written = 0;
+
+     fp = begin_file(filename);
+     if (fp != NULL)
+     {
+          setvbuf(fp, NULL, _IONBF, 0); /* no copy into a stdio buffer */
+          written = fwrite(data->buffer, 1, data->size, fp);
+          if (publish_file(fp, filename) != 0)
+               written = 0;
+     }
+     free(data->buffer);
+     data->buffer = NULL;
+     return (written == data->size ? 0 : 1);
+}
+
+
+static int parse_text(char *text, int dimension, binary_data *data)
+/* Parses 'text', the content of a data file in the text format, into
+   'data' as if it had been read in the binary format. The first number
+   is the number of IDs in sel and arc files ('dimension' 0) and the
+   number of all numbers in ini and var files.
+   Returns 0 if successful and 1 if 'text' is incomplete or invalid. */
+{
+     char *end;
+     long size;
+     int count, i, j;
+
+     size = strtol(text, &end, 10);
+     if (end == text || size < 0 || size % (dimension + 1) != 0)
+          return (1);
+     count = (int) (size / (dimension + 1));
+     if (new_binary(data, count, dimension) != 0)
+          return (1);
+     for (i = 0; i < count; i++)
+     {
+          text = end;
+          data->ids[i] = (int) strtol(text, &end, 10);
+          for (j = 0; j < dimension && end != text; j++)
+          {
+               text = end;
+               data->values[i * dimension + j] = strtod(text, &end);
+          }
+          if (end == text) /* file not completely written */
+               break;
+     }
+     while (*end == ' ' || *end == '\n' || *end == '\r' || *end == '\t')
+          end++;
+     if (i < count || strncmp(end, "END", 3) != 0)
+     {
+          free(data->buffer);
+          data->buffer = NULL;
+          return (1);
+     }
+     return (0);
+}
+
+
+int read_data(char *filename, int dimension, binary_data *data)
+/* Reads the data file 'filename', in either format, into 'data' with a
+   single read of the whole file. 'dimension' is the number of objective
+   values per record, 0 for sel and arc files. Returns 0 if successful
+   (free 'data->buffer' when done) and 1 if the file cannot be read or
+   is not completely written or invalid. */
+{
+     char *buffer;
+     size_t size;
+     int numbers[3];
+     int result;
+
+     buffer = read_file(filename, &size);
+     if (buffer == NULL)
+          return (1);
+     if (size < 4 || memcmp(buffer, BINARY_MAGIC, 4) != 0)
+     {
+          result = parse_text(buffer, dimension, data);
+          free(buffer);
+          return (result);
+     }
+
+     if (size >= BINARY_HEADER)
+          memcpy(numbers, buffer + 4, sizeof(numbers));
+     if (size < BINARY_HEADER || numbers[0] < 0 || numbers[1] != dimension
+         || size != BINARY_HEADER + binary_ids_bytes(numbers[0])
+         + (size_t) numbers[0] * dimension * sizeof(double))
+     {
+          free(buffer);
+          return (1);
+     }
+     data->count = numbers[0];
+     data->dimension = dimension;
+     data->buffer = buffer;
+     data->size = size;
+     data->ids = (int *) (buffer + BINARY_HEADER);
+     data->values = (double *) (buffer + BINARY_HEADER
+                                + binary_ids_bytes(data->count));
+     return (0);
+}
+
 
 /*-------------------------| functions for handling state file |--------*/
 
@@ -76,6 +1015,17 @@ int write_state(int state)
 
      assert(0 <= state <= 11);
      
+     if (transport != TRANSPORT_FILE)
+     {
+          set_shm_word(SHM_STA, state);
+#ifdef PISA_SOCKET
+          if (transport == TRANSPORT_SOCKET && state == 3)
+               var_unfetched = 1;
+          answer_wait(0);
+#endif
+          return (0);
+     }
+
      fp = fopen(sta_file, "w");
      assert(fp != NULL);
      fprintf(fp, "%d", state);
@@ -90,6 +1040,14 @@ int read_state()
      int result;
      int state = -1;
      FILE *fp;
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET)
+          serve_peer(0); /* requests that came in meanwhile */
+#endif
+     if (transport != TRANSPORT_FILE)
+          return (read_shm_state());
+
      fp = fopen(sta_file, "r");
      if (fp != NULL)
      {
@@ -118,6 +1076,125 @@ int state_error(int error, int linenumber)
 }
 
 
+#ifdef PISA_INOTIFY
+
+static int notify_fd = -2;
+/* inotify instance watching the directory of the state file; -1 if
+   inotify is not available, -2 before the first call of wait() */
+
+
+static int watch_directory(char *file)
+/* Adds the directory of 'file' to the directories watched by
+   'notify_fd' for files written or moved there.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char dir[FILE_NAME_LENGTH_INTERNAL];
+     char *slash = strrchr(file, '/');
+
+     if (slash == NULL)
+          strcpy(dir, ".");
+     else if (slash == file)
+          strcpy(dir, "/");
+     else
+     {
+          strncpy(dir, file, slash - file);
+          dir[slash - file] = '\0';
+     }
+     if (inotify_add_watch(notify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+          return (1);
+     return (0);
+}
+
+
+static int is_file(const char *name, char *file)
+/* Returns 1 if 'name' is the last component of the path 'file' and 0
+   otherwise. */
+{
+     char *slash = strrchr(file, '/');
+     return (strcmp(name, (slash == NULL) ? file : slash + 1) == 0);
+}
+
+
+static int state_file_written()
+/* Reads all pending events from 'notify_fd'. Returns 1 if one of them
+   may concern the state file and 0 otherwise. */
+{
+     union
+     {
+          struct inotify_event event; /* for the alignment */
+          char bytes[4096];
+     } buffer;
+     struct inotify_event *event;
+     ssize_t length;
+     char *p;
+     int found = 0;
+
+     while ((length = read(notify_fd, buffer.bytes, sizeof(buffer))) > 0)
+     {
+          for (p = buffer.bytes; p < buffer.bytes + length;
+               p += sizeof(struct inotify_event) + event->len)
+          {
+               event = (struct inotify_event *) p;
+               if ((event->mask & IN_Q_OVERFLOW)
+                   || (event->len > 0 && (is_file(event->name, sta_file))))
+                    found = 1;
+          }
+     }
+     return (found);
+}
+
+
+static int wait_for_state_file(double sec)
+/* Sleeps until the state file is written, but at most 'sec' seconds.
+   Returns 0 if it waited and 1 if inotify is not available. */
+{
+     struct timespec now, end;
+     struct timeval timeout;
+     fd_set fds;
+     long usec;
+
+     if (notify_fd == -2)
+     {
+          notify_fd = inotify_init1(IN_NONBLOCK);
+          if (notify_fd >= 0 && (watch_directory(sta_file) != 0))
+          {
+               close(notify_fd);
+               notify_fd = -1;
+          }
+     }
+     if (notify_fd < 0)
+          return (1);
+
+     clock_gettime(CLOCK_MONOTONIC, &end);
+     end.tv_sec += (time_t) floor(sec);
+     end.tv_nsec += (long) ((sec - floor(sec)) * 1e9);
+     if (end.tv_nsec >= 1000000000L)
+     {
+          end.tv_sec++;
+          end.tv_nsec -= 1000000000L;
+     }
+     /* events queued since the last call count as well, so a state
+        written while this process was busy is not missed */
+     while (!state_file_written())
+     {
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          usec = (end.tv_sec - now.tv_sec) * 1000000L
+               + (end.tv_nsec - now.tv_nsec + 999) / 1000;
+          if (usec <= 0)
+               break;
+          timeout.tv_sec = usec / 1000000L;
+          timeout.tv_usec = usec % 1000000L;
+          FD_ZERO(&fds);
+          FD_SET(notify_fd, &fds);
+          if (select(notify_fd + 1, &fds, NULL, NULL, &timeout) <= 0)
+               break; /* time is up (or interrupted) */
+     }
+     return (0);
+}
+
+#endif
+
+
 int wait(double sec)
 /* Makes the calling process sleep for 'sec' seconds.
    
@@ -146,6 +1223,20 @@ int wait(double sec)
      assert((int_sec * 1e6) + usec >= 10000);  /* you might change this one
                                                   if you know what you are
                                                   doing */
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET)
+     {
+          serve_peer(sec);
+          return (0);
+     }
+#endif
+     if (transport == TRANSPORT_SHM && wait_for_change(sec) == 0)
+          return (0);
+#ifdef PISA_INOTIFY
+     if (wait_for_state_file(sec) == 0)
+          return (0);
+#endif
     
      sleep(int_sec);
      usleep(usec);
@@ -300,6 +1391,44 @@ int read_common_parameters()
      result = fscanf(fp, "%d", &dimension);
      assert(result != EOF); /* no EOF, dim correctly read */
      assert(dimension > 0);
+
+     /* optional entries */
+     while (fscanf(fp, "%s", str) == 1)
+     {
+          if (strcmp(str, "transport") == 0)
+          {
+               result = fscanf(fp, "%s", str);
+               assert(result == 1);
+               if (strcmp(str, "shm") == 0)
+                    cfg_transport = TRANSPORT_SHM;
+               else if (strcmp(str, "socket") == 0)
+               {
+                    cfg_transport = TRANSPORT_SOCKET;
+                    result = fscanf(fp, "%s", socket_address);
+                    assert(result == 1);
+               }
+               else
+               {
+                    assert(strcmp(str, "file") == 0);
+                    cfg_transport = TRANSPORT_FILE;
+               }
+          }
+          else
+          {
+               assert(strcmp(str, "format") == 0);
+               result = fscanf(fp, "%s", str);
+               assert(result == 1);
+               /* a big-endian host stays with the text format */
+               if (strcmp(str, "binary") == 0 && little_endian())
+                    format = FORMAT_BINARY;
+               else
+               {
+                    assert(strcmp(str, "binary") == 0
+                           || strcmp(str, "text") == 0);
+                    format = FORMAT_TEXT;
+               }
+          }
+     }
      
      fclose(fp);     
      return (0);
@@ -334,6 +1463,9 @@ int check_ini()
 
      FILE *fp;
 
+     if (transport != TRANSPORT_FILE)
+          return (get_shm_word(SHM_INI) != 0);
+
      fp = fopen(ini_file, "r");
      assert(fp != NULL);
      fscanf(fp, "%d", &control_element);
@@ -352,6 +1484,9 @@ int check_var()
 
      FILE *fp;
 
+     if (transport != TRANSPORT_FILE)
+          return (get_shm_word(SHM_VAR) != 0);
+
      fp = fopen(var_file, "r");
      assert(fp != NULL);
      fscanf(fp, "%d", &control_element);
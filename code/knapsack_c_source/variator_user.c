@@ -73,6 +73,15 @@ double recom_prob;
  * independent bit mutation */
 double bit_turn_prob;
 
+int steady = 0; /* 1 to make the next offspring while the selector
+                   selects (optional parameter) */
+/* steady state: the parents of the next offspring (if 'have_parents')
+   and these offspring, made ready and held (if 'have_offspring') */
+int *next_parents = NULL;
+int have_parents = 0;
+int *ready_offspring = NULL;
+int have_offspring = 0;
+
 
 
 /*-------------------------| individual |-------------------------------*/
@@ -238,6 +247,16 @@ int state2()
           return (1);
      }
      
+     /**********| added for KNAPSACK |**************/
+
+     /* steady state: if the selector was faster than
+        prepare_offspring(), make up for it before read_arc() removes the
+        parents, so the children do not depend on the timing */
+     if (prepare_offspring() == 1)
+          return (1);
+
+     /**********| addition for KNAPSACK end |*******/
+
      result = read_sel(parent_identities);
      if (result != 0) /* if some file reading error occurs, return 2 */
           return (2);
@@ -248,7 +267,10 @@ int state2()
 
      /**********| added for KNAPSACK |**************/
 
-     result = variate(parent_identities, offspring_identities);
+     if (steady)
+          result = steady_variate(parent_identities, offspring_identities);
+     else
+          result = variate(parent_identities, offspring_identities);
      if (result != 0)
           return (1);
 
@@ -273,6 +295,32 @@ int state2()
 }
  
 
+int prepare_offspring()
+/* Called instead of waiting while the selector selects.
+
+   post: Optionally (steady state) the next 'lambda' children generated
+         from the parents read in the last state2(), added to the global
+         population and held with hold_individuals(), for the next
+         state2() to write them right away.
+         Return value == 0 if something was done,
+                      == 1 if unspecified errors happened,
+                      == 2 if there was nothing to do.
+*/
+{
+     /**********| added for KNAPSACK |**************/
+
+     if (!steady || !have_parents || have_offspring)
+          return (2);
+     if (variate(next_parents, ready_offspring) != 0)
+          return (1);
+     have_parents = 0;
+     have_offspring = 1;
+     return (hold_individuals(ready_offspring, lambda));
+
+     /**********| addition for KNAPSACK end |*******/
+}
+
+
 int state4() 
 /* Do what needs to be done in state 4.
 
@@ -287,6 +335,9 @@ int state4()
      /**********| added for KNAPSACK |**************/
      
      int result;
+
+     have_parents = have_offspring = 0; /* unwritten offspring go */
+     hold_individuals(NULL, 0);
      result = read_arc();
    
      if (0 == result) /* arc file correctly read
@@ -349,7 +400,9 @@ int state8()
    int result;
    
    gen = 1;
-     
+
+   have_parents = have_offspring = 0; /* unwritten offspring go */
+   hold_individuals(NULL, 0);
    result = read_arc();
 
    if (0 == result) /* arc file correctly read
@@ -494,6 +547,39 @@ int read_local_parameters()
 
 
      assert(result != EOF); /* no EOF, outfile correctly read */
+
+     /* optional parameters */
+     steady = 0;
+     while (fscanf(fp, "%s", str) == 1)
+     {
+          if (strcmp(str, "steady") == 0)
+          {
+               result = fscanf(fp, "%d", &steady);
+               assert(result == 1);
+          }
+          else
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "unknown parameter in parameter file");
+               fclose(fp);
+               return (1);
+          }
+     }
+     if (steady)
+     {
+          free(next_parents);
+          free(ready_offspring);
+          next_parents = (int *) malloc(mu * sizeof(int));
+          ready_offspring = (int *) malloc(lambda * sizeof(int));
+          have_parents = have_offspring = 0;
+          if (next_parents == NULL || ready_offspring == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "variator out of memory");
+               fclose(fp);
+               return (1);
+          }
+     }
      
      srand(seed); /* seeding random number generator */
 
@@ -549,6 +635,25 @@ int read_local_parameters()
 }
 
 
+/* Steady state: returns the children prepare_offspring() made ready in
+   'offspring' and keeps 'parents' for the next ones. */
+int steady_variate(int *parents, int *offspring)
+{
+     if (have_offspring)
+     {
+          memcpy(offspring, ready_offspring, lambda * sizeof(int));
+          have_offspring = 0;
+          if (hold_individuals(NULL, 0) != 0)
+               return (1);
+     }
+     else if (variate(parents, offspring) != 0) /* first offspring */
+          return (1);
+     memcpy(next_parents, parents, mu * sizeof(int));
+     have_parents = 1;
+     return (0);
+}
+
+
 /* Performs variation. */
 int variate(int *selected, int *result_ids)
 {
@@ -114,6 +114,19 @@ int state2();
 */
 
 
+int prepare_offspring();
+/* Called instead of waiting while the selector selects.
+
+   post: Optionally (steady state) the next 'lambda' children generated
+         from the parents read in the last state2(), added to the global
+         population and held with hold_individuals(), for the next
+         state2() to write them right away.
+         Return value == 0 if something was done,
+                      == 1 if unspecified errors happened,
+                      == 2 if there was nothing to do.
+*/
+
+
 int state4();
 /* Do what needs to be done in state 4.
 
@@ -176,6 +189,11 @@ int is_finished();
 int read_local_parameters();
 /* read local parameters from file */
 
+int steady_variate(int *parents, int *offspring);
+/* Steady state: returns the children prepare_offspring() made ready in
+   'offspring' and keeps 'parents' for the next ones.
+   Returns 0 if successful and 1 otherwise.*/
+
 individual *new_individual();
 
 individual *copy_individual(individual* ind);
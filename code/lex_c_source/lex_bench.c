@@ -0,0 +1,381 @@
+/*========================================================================
+  PISA  (www.tik.ee.ethz.ch/pisa/)
+
+  ========================================================================
+  Computer Engineering (TIK)
+  ETH Zurich
+
+  ========================================================================
+  LEX - Lexicase Selection
+
+  Benchmark of select_ind() on synthetic populations, without the PISA
+  file interface.
+
+  Fills the global population with one of three kinds of objective
+  vectors, runs a number of generations of selection (mu = population
+  size) and reports selections per second, cases and individual-case
+  comparisons per selection, and the allocations made per generation.
+  Allocations are counted by wrapping malloc() and friends at link time
+  (see BENCH_WRAP in the Makefile) and by replacing operator new.
+
+  With -crossover it instead times the 'first_filter' modes
+  FIRST_FILTER_SCAN and FIRST_FILTER_SORTED for a range of population
+  sizes, with and without the prefix cache. The sorted mode pays for
+  sorting every objective once per generation and wins once the first
+  filters of the mu selection events cost more than that; the prefix
+  cache does the first filter only once per case, which moves the
+  crossover to much larger populations.
+
+  Usage: lex_bench [options]
+
+    -n size        population size (default 250)
+    -d dimension   number of objectives (default 10)
+    -e epsilon     0, 1 or 2 as in the parameter file (default 1)
+    -t threads     number of OpenMP threads (default: OpenMP's choice)
+    -g generations number of generations to time (default 100)
+    -data kind     random: uniform in [0,1)
+                   dtlz2: points on nested DTLZ2 fronts, radius 1 to 2
+                   dup: few distinct vectors on a coarse grid
+                   (default random)
+    -p paramfile   read the local parameters from 'paramfile' as the
+                   selector does ('-e' is then ignored)
+    -crossover     compare the first_filter modes instead
+
+  file: lex_bench.c
+  author: William La Cava, lacava@upenn.edu
+
+  ========================================================================
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <new>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "selector.h"
+#include "selector_user.h"
+#include "selector_internal.h"
+
+#define BENCH_CROSSOVER_MAX 16384
+
+/*-----------------------| allocation counting |------------------------*/
+
+/* calls to the allocation functions of the C library (through the
+   linker's --wrap) and to operator new */
+static long c_allocations = 0;
+static long new_allocations = 0;
+
+extern "C"
+{
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+int __real_posix_memalign(void **p, size_t align, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+     __atomic_fetch_add(&c_allocations, 1, __ATOMIC_RELAXED);
+     return (__real_malloc(size));
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+     __atomic_fetch_add(&c_allocations, 1, __ATOMIC_RELAXED);
+     return (__real_calloc(n, size));
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+     __atomic_fetch_add(&c_allocations, 1, __ATOMIC_RELAXED);
+     return (__real_realloc(p, size));
+}
+
+int __wrap_posix_memalign(void **p, size_t align, size_t size)
+{
+     __atomic_fetch_add(&c_allocations, 1, __ATOMIC_RELAXED);
+     return (__real_posix_memalign(p, align, size));
+}
+}
+
+void *operator new(size_t size)
+{
+     void *p;
+
+     __atomic_fetch_add(&new_allocations, 1, __ATOMIC_RELAXED);
+     p = __real_malloc(size > 0 ? size : 1);
+     if (p == NULL)
+          throw std::bad_alloc();
+     return (p);
+}
+
+void operator delete(void *p) noexcept
+{
+     free(p);
+}
+
+/*-------------------------| synthetic data |---------------------------*/
+
+/* seconds on a monotonic clock */
+static double now()
+{
+     struct timespec t;
+     clock_gettime(CLOCK_MONOTONIC, &t);
+     return (t.tv_sec + 1e-9 * t.tv_nsec);
+}
+
+/* standard normal deviate (Box-Muller) */
+static double normal(lex_rng *rng)
+{
+     double u = 1.0 - rng_uniform(rng); /* in (0,1] */
+     return (sqrt(-2.0 * log(u)) * cos(6.283185307179586 * rng_uniform(rng)));
+}
+
+/* Adds individuals 0..size-1 with objective vectors of the given kind to
+   the global population. Returns 0 if successful and 1 otherwise. */
+static int fill_population(const char *kind, int size)
+{
+     double *objs;
+     double *protos = NULL;
+     int nprotos = size / 20 + 1;
+     lex_rng rng;
+     int i, o;
+
+     if (strcmp(kind, "random") != 0 && strcmp(kind, "dtlz2") != 0
+         && strcmp(kind, "dup") != 0)
+     {
+          printf("lex_bench - unknown data kind '%s'\n", kind);
+          return (1);
+     }
+     objs = (double *) malloc(dimension * sizeof(double));
+     if (objs == NULL)
+          return (1);
+     if (begin_generation(size) != 0)
+          return (1);
+     rng_init(&rng, -1, 0);
+     if (strcmp(kind, "dup") == 0)
+     {
+          /* every individual copies one of size/20 + 1 prototypes */
+          protos = (double *) malloc(nprotos * dimension * sizeof(double));
+          if (protos == NULL)
+          {
+               free(objs);
+               return (1);
+          }
+          for (i = 0; i < nprotos * dimension; i++)
+               protos[i] = irand(&rng, 5);
+     }
+     for (i = 0; i < size; i++)
+     {
+          if (strcmp(kind, "random") == 0)
+          {
+               for (o = 0; o < dimension; o++)
+                    objs[o] = rng_uniform(&rng);
+          }
+          else if (strcmp(kind, "dtlz2") == 0)
+          {
+               /* direction uniform on the positive orthant of the unit
+                  sphere, scaled by 1 + g as in DTLZ2 */
+               double norm = 0;
+               double radius = 1.0 + rng_uniform(&rng);
+               for (o = 0; o < dimension; o++)
+               {
+                    objs[o] = fabs(normal(&rng));
+                    norm += objs[o] * objs[o];
+               }
+               norm = sqrt(norm);
+               for (o = 0; o < dimension; o++)
+                    objs[o] = (norm > 0) ? radius * objs[o] / norm : radius;
+          }
+          else
+          {
+               int p = irand(&rng, nprotos);
+               for (o = 0; o < dimension; o++)
+                    objs[o] = protos[p * dimension + o];
+          }
+          if (add_individual(i, objs) != 0)
+               return (1);
+     }
+     free(protos);
+     free(objs);
+     return (0);
+}
+
+/*-------------------------| benchmarks |-------------------------------*/
+
+/* mean seconds per call of select_ind() on the first 'size' identities */
+static double time_selection(int size, int *ids, int *parents, int repeats)
+{
+     double start;
+     int r;
+
+     mu = size;
+     select_ind(size, ids, parents, dimension); /* warm up the buffers */
+     start = now();
+     for (r = 0; r < repeats; r++)
+          select_ind(size, ids, parents, dimension);
+     return ((now() - start) / repeats);
+}
+
+/* Runs 'generations' generations of selection on 'ids' and prints the
+   counters. Returns 0 if successful and 1 otherwise. */
+static int run(int size, int *ids, int generations)
+{
+     int *parents = (int *) malloc(size * sizeof(int));
+     double start, seconds, selections;
+     long cases = 0, work = 0, c_before, new_before;
+     int g;
+
+     if (parents == NULL)
+          return (1);
+     mu = size;
+     if (select_ind(size, ids, parents, dimension) != 0) /* warm up */
+          return (1);
+     c_before = c_allocations;
+     new_before = new_allocations;
+     start = now();
+     for (g = 0; g < generations; g++)
+     {
+          if (select_ind(size, ids, parents, dimension) != 0)
+               return (1);
+          cases += last_stats.cases;
+          work += last_stats.work;
+     }
+     seconds = now() - start;
+     selections = (double) generations * mu;
+
+     printf("selections/sec        %14.4g\n", selections / seconds);
+     printf("ms/generation         %14.4f\n", 1e3 * seconds / generations);
+     printf("cases/selection       %14.4f\n", cases / selections);
+     printf("comparisons/selection %14.4f\n", work / selections);
+     printf("malloc/generation     %14.4f\n",
+            (double) (c_allocations - c_before) / generations);
+     printf("new/generation        %14.4f\n",
+            (double) (new_allocations - new_before) / generations);
+     free(parents);
+     return (0);
+}
+
+/* Times the two first_filter modes for growing populations. Returns 0 if
+   successful and 1 otherwise. */
+static int crossover(const char *kind, int repeats)
+{
+     int *ids = (int *) malloc(BENCH_CROSSOVER_MAX * sizeof(int));
+     int *parents = (int *) malloc(BENCH_CROSSOVER_MAX * sizeof(int));
+     int size, depth, i;
+
+     if (ids == NULL || parents == NULL
+         || fill_population(kind, BENCH_CROSSOVER_MAX) != 0)
+          return (1);
+     for (i = 0; i < BENCH_CROSSOVER_MAX; i++)
+          ids[i] = i;
+     for (depth = 0; depth <= 2; depth += 2)
+     {
+          cache_depth = depth;
+          printf("\ncache_depth %d\n", depth);
+          printf("%8s %14s %14s %8s\n", "size", "scan [ms]", "sorted [ms]",
+                 "speedup");
+          for (size = 64; size <= BENCH_CROSSOVER_MAX; size *= 2)
+          {
+               double scan, sorted;
+               first_filter = FIRST_FILTER_SCAN;
+               scan = time_selection(size, ids, parents, repeats);
+               first_filter = FIRST_FILTER_SORTED;
+               sorted = time_selection(size, ids, parents, repeats);
+               printf("%8d %14.3f %14.3f %8.2f\n", size, 1e3 * scan,
+                      1e3 * sorted, scan / sorted);
+          }
+     }
+     free(ids);
+     free(parents);
+     return (0);
+}
+
+int main(int argc, char *argv[])
+{
+     int size = 250;
+     int mode = 1;
+     int threads = 0;
+     int generations = 100;
+     const char *kind = "random";
+     bool sweep = false;
+     int *ids;
+     int i;
+
+     dimension = 10;
+     for (i = 1; i < argc; i++)
+     {
+          bool has_value = (i + 1 < argc);
+          if (strcmp(argv[i], "-n") == 0 && has_value)
+               size = atoi(argv[++i]);
+          else if (strcmp(argv[i], "-d") == 0 && has_value)
+               dimension = atoi(argv[++i]);
+          else if (strcmp(argv[i], "-e") == 0 && has_value)
+               mode = atoi(argv[++i]);
+          else if (strcmp(argv[i], "-t") == 0 && has_value)
+               threads = atoi(argv[++i]);
+          else if (strcmp(argv[i], "-g") == 0 && has_value)
+               generations = atoi(argv[++i]);
+          else if (strcmp(argv[i], "-data") == 0 && has_value)
+               kind = argv[++i];
+          else if (strcmp(argv[i], "-p") == 0 && has_value)
+               sscanf(argv[++i], "%s", paramfile);
+          else if (strcmp(argv[i], "-crossover") == 0)
+               sweep = true;
+          else
+          {
+               printf("lex_bench - unknown argument '%s'\n", argv[i]);
+               return (1);
+          }
+     }
+     if (size < 1 || dimension < 1 || generations < 1 || mode < 0
+         || mode > 2)
+     {
+          printf("lex_bench - invalid arguments\n");
+          return (1);
+     }
+
+     lex_seed = 1;
+     eplex = (mode != 0);
+     dynamic_epsilon = (mode == 2);
+     if (paramfile[0] != '\0' && read_local_parameters() != 0)
+          return (1);
+     mode = eplex + dynamic_epsilon;
+#ifdef _OPENMP
+     if (threads > 0)
+          omp_set_num_threads(threads);
+     threads = omp_get_max_threads();
+#else
+     threads = 1;
+#endif
+     global_population.slot_ind = NULL;
+
+     if (sweep)
+     {
+          printf("data %s, dimension %d, epsilon %d, %d threads\n", kind,
+                 dimension, mode, threads);
+          if (crossover(kind, 3) != 0)
+               return (1);
+          clean_population();
+          return (0);
+     }
+
+     ids = (int *) malloc(size * sizeof(int));
+     if (ids == NULL || fill_population(kind, size) != 0)
+          return (1);
+     for (i = 0; i < size; i++)
+          ids[i] = i;
+     printf("data %s, size %d, dimension %d, epsilon %d, %d threads, "
+            "%d generations\n", kind, size, dimension, mode, threads,
+            generations);
+     if (run(size, ids, generations) != 0)
+          return (1);
+
+     free(ids);
+     clean_population();
+     return (0);
+}
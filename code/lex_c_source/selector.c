@@ -32,6 +32,11 @@
 #include "selector_user.h"
 #include "selector_internal.h"
 
+#ifdef PISA_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 
 /*--------------------| global variable definitions |-------------------*/
 
@@ -45,12 +50,24 @@ int lambda; /* number of offspring individuals */
 
 int dimension; /* number of objectives */
 
+
+/* only used in this file */
+
+static void set_file_names(char *filenamebase);
+
+#ifndef PISA_NO_MAIN
+static int is_directory(char *name);
+static int serve_runs(int count, char *names[], double poll);
+#endif
+
 /*-------------------------| main() |-----------------------------------*/
 
+#ifndef PISA_NO_MAIN /* defined when the selector is linked into another
+                        program, e.g. lex_bench */
 int main(int argc, char *argv[])
 {
-     int returncode; /* storing the values that the state functions return */
      int current_state = 0;
+     int next_state;
 
      //printf("current_state:%i\n",current_state);
 
@@ -59,7 +76,7 @@ int main(int argc, char *argv[])
 
      double poll; /* polling interval in seconds */
      
-     if (argc == 4)
+     if (argc == 4 && !is_directory(argv[2]))
      {
           sscanf(argv[1], "%s", paramfile); /* paramfile defined in
                                              * selector_user.h */
@@ -67,6 +84,13 @@ int main(int argc, char *argv[])
           sscanf(argv[3], "%lf", &poll);
           assert(poll >= 0);
      }
+     else if (argc >= 4) /* several runs, or a directory of runs */
+     {
+          sscanf(argv[1], "%s", paramfile);
+          sscanf(argv[argc - 1], "%lf", &poll);
+          assert(poll >= 0);
+          return (serve_runs(argc - 3, argv + 2, poll));
+     }
      else
      {
           printf("Selector - wrong number of arguments\n");
@@ -74,125 +98,352 @@ int main(int argc, char *argv[])
      }  
      
      /* generate file names based on 'filenamebase'*/
-     sprintf(var_file, "%svar", filenamebase);
-     sprintf(sel_file, "%ssel", filenamebase);
-     sprintf(cfg_file, "%scfg", filenamebase);
-     sprintf(ini_file, "%sini", filenamebase);
-     sprintf(arc_file, "%sarc", filenamebase);
-     sprintf(sta_file, "%ssta", filenamebase);
+     set_file_names(filenamebase);
+
+     if (open_transport(filenamebase) != 0)
+     {
+          printf("Selector - cannot open the transport\n");
+          return (1);
+     }
 
      /* initialize global_population (just in case we terminate
         before the population is set up.) */
 
-     global_population.individual_array = NULL;
+     global_population.slot_ind = NULL;
      
      
-     /* state machine: uses the stateX() functions to do the steps required
-        in state X. Those state functions have to be implemented by 
-        the user in selector_user.c */
+     /* state machine: selector_step() uses the stateX() functions to do
+        the steps required in state X. Those state functions have to be
+        implemented by the user in selector_user.c */
 
      while (current_state != 6) /* stop state for selector */
           /* Caution: if reading of the statefile fails
              (e.g. no permission) this is an infinite loop */
      {
           current_state = read_state();
-          if (current_state == 1) /* inital selection */
-          { 
-               read_common_parameters();
-               
-               returncode = state1();
-               if (returncode == 0)
+          next_state = (current_state == 6) ? -1
+               : selector_step(current_state);
+
+          if (next_state == -1) /* state == -1 (reading failed) or state
+                                   concerns variator */
+          {
+               wait(poll);
+          }
+          else if (next_state != current_state)
+          {
+               current_state = next_state;
+               write_state(current_state);
+          } /* else don't do anything and read the state again */
+     } /* state == 6 (stop) */
+  
+     write_state(selector_step(6));
+     close_transport(1); /* the monitor may still read the state */
+  
+     return (0);
+}
+
+
+/*-------------------------| several runs |-----------------------------*/
+
+static int is_directory(char *name)
+/* Returns 1 if 'name' is a directory and 0 otherwise. */
+{
+#ifdef PISA_UNIX
+     struct stat info;
+
+     return (stat(name, &info) == 0 && S_ISDIR(info.st_mode));
+#else
+     return (0);
+#endif
+}
+
+
+static int add_run(char *filenamebase, run_state **runs, int *count)
+/* Appends the run with 'filenamebase' to the '*count' runs in '*runs'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     run_state *grown;
+
+     if (strlen(filenamebase) + 4 > FILE_NAME_LENGTH_INTERNAL)
+     {
+          printf("Selector - filename base too long: %s\n", filenamebase);
+          return (1);
+     }
+     grown = (run_state *) realloc(*runs, (*count + 1) * sizeof(run_state));
+     if (grown == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          return (1);
+     }
+     *runs = grown;
+     strcpy(grown[*count].filenamebase, filenamebase);
+     (*count)++;
+     return (0);
+}
+
+
+static int add_runs(char *name, run_state **runs, int *count)
+/* Appends the run with the filename base 'name' to the '*count' runs in
+   '*runs', or if 'name' is a directory, a run with the filename base
+   'name/d/PISA_' for each subdirectory 'd', in alphabetical order.
+   Returns 0 if successful and 1 otherwise. */
+{
+#ifdef PISA_UNIX
+     char base[FILE_NAME_LENGTH_INTERNAL + 16];
+     char dir[FILE_NAME_LENGTH_INTERNAL];
+     struct dirent **entries;
+     int length = strlen(name);
+     int n, i;
+     int result = 0;
+
+     if (!is_directory(name))
+          return (add_run(name, runs, count));
+
+     if (length >= FILE_NAME_LENGTH_INTERNAL)
+          return (add_run(name, runs, count)); /* reports the error */
+     strcpy(dir, name);
+     while (length > 1 && dir[length - 1] == '/')
+          dir[--length] = '\0';
+     n = scandir(dir, &entries, NULL, alphasort);
+     if (n < 0)
+     {
+          printf("Selector - cannot read the directory %s\n", dir);
+          return (1);
+     }
+     for (i = 0; i < n; i++)
+     {
+          if (result == 0 && entries[i]->d_name[0] != '.')
+          {
+               /* leave room for the "/PISA_" appended below */
+               int room = sizeof base - strlen("/PISA_");
+               length = snprintf(base, room, "%s/%s", dir,
+                                 entries[i]->d_name);
+               if (length < 0 || length >= room)
                {
-                    current_state = 2;
-                    write_state(current_state);
+                    printf("Selector - file name too long: %s/%s\n", dir,
+                           entries[i]->d_name);
+                    result = 1;
                }
-               else if (returncode != 2)
+               else if (is_directory(base))
                {
-                    state_error(1, __LINE__);
-                    
+                    strcat(base, "/PISA_");
+                    result = add_run(base, runs, count);
                }
           }
-          
-          else if (current_state == 3) /* selection */
+          free(entries[i]);
+     }
+     free(entries);
+     return (result);
+#else
+     return (add_run(name, runs, count));
+#endif
+}
+
+
+static int serve_runs(int count, char *names[], double poll)
+/* Serves the runs with the filename bases (or directories of runs, see
+   add_runs()) 'names' in this process: handles the state of each run
+   that is ready and waits only when none of them is. The selections of
+   a run are parallel (OpenMP), the runs take turns. Returns when all of
+   them have been stopped (state 6) and their transports are closed, 0
+   if successful and 1 otherwise. */
+{
+     run_state *runs = NULL;
+     run_state initial; /* global variables before any run is set up */
+     int number = 0;
+     int running;
+     int progress;
+     int state, next_state;
+     int i;
+
+     for (i = 0; i < count; i++)
+          if (add_runs(names[i], &runs, &number) != 0)
+          {
+               free(runs);
+               return (1);
+          }
+     if (number == 0)
+     {
+          printf("Selector - no runs to serve\n");
+          return (1);
+     }
+
+     global_population.slot_ind = NULL;
+     save_run(&initial);
+     for (i = 0; i < number; i++)
+     {
+          load_run(&initial);
+          set_file_names(runs[i].filenamebase);
+          if (open_transport(runs[i].filenamebase) != 0)
+          {
+               printf("Selector - cannot open the transport of %s\n",
+                      runs[i].filenamebase);
+               free(runs);
+               return (1);
+          }
+          watch_state_file();
+          runs[i].stopped = 0;
+          runs[i].closed = 0;
+          save_run(&runs[i]);
+     }
+
+     /* the same state machine as in main(), for each run in turn */
+     running = number;
+     while (running > 0)
+     {
+          progress = 0;
+          for (i = 0; i < number; i++)
           {
-               if (check_sel() == 0 && check_arc() == 0)
+               if (runs[i].closed)
+                    continue;
+               load_run(&runs[i]);
+               state = read_state();
+               if (runs[i].stopped) /* the monitor may still read the
+                                       state */
                {
-                    returncode = state3();
-                    if (returncode == 0)
+                    if (close_transport(0) == 0)
                     {
-                         current_state = 2;
-                         write_state(current_state);
+                         runs[i].closed = 1;
+                         running--;
                     }
-                    else if (returncode != 2)
-                    {
-                         state_error(3, __LINE__);
-                    } /* else don't do anything and wait again */ 
                }
-          }
-          
-          else if (current_state == 5) /* variator just terminated,
-                                          here you can do what you want */
-          {
-               returncode = state5();/* e.g., terminate too */
-               if (returncode == 0)
+               else if (state == 6) /* stop */
                {
-                    current_state = 6;
-                    write_state(current_state);
+                    write_state(selector_step(6));
+                    runs[i].stopped = 1;
+                    progress = 1;
                }
-               else if (returncode != 2)
+               else
                {
-                    state_error(5, __LINE__);
-               } /* else don't do anything and wait again */ 
-
+                    next_state = selector_step(state);
+                    if (next_state != -1 && next_state != state)
+                    {
+                         write_state(next_state);
+                         progress = 1;
+                    }
+               }
+               save_run(&runs[i]);
           }
-      
-          else if (current_state == 9) /* variator ready for reset,
-                                          here you can do what you want */
+          if (!progress && running > 0)
+               wait_for_runs(runs, number, poll);
+     }
+
+     free(runs);
+     return (0);
+}
+#endif /* PISA_NO_MAIN */
+
+
+/*-------------------------| state machine |----------------------------*/
+
+static void set_file_names(char *filenamebase)
+/* Generates the file names based on 'filenamebase'. */
+{
+     sprintf(var_file, "%svar", filenamebase);
+     sprintf(sel_file, "%ssel", filenamebase);
+     sprintf(cfg_file, "%scfg", filenamebase);
+     sprintf(ini_file, "%sini", filenamebase);
+     sprintf(arc_file, "%sarc", filenamebase);
+     sprintf(sta_file, "%ssta", filenamebase);
+}
+
+
+int selector_step(int state)
+/* Does the steps required in 'state' with the stateX() functions.
+   Returns the state to write next, 'state' if the step has to be tried
+   again (e.g. the files are not completely written yet) and -1 if
+   'state' does not concern the selector. Calls state_error() if a
+   state function fails. */
+{
+     int returncode; /* storing the values that the state functions return */
+
+     if (state == 1) /* inital selection */
+     { 
+          read_common_parameters();
+               
+          returncode = state1();
+          if (returncode == 0)
+               return (2);
+          else if (returncode != 2)
+               state_error(1, __LINE__);
+          return (state);
+     }
+          
+     else if (state == 3) /* selection */
+     {
+          if (check_sel() == 0 && check_arc() == 0)
           {
-               returncode = state9();/* e.g., get ready for reset too */
+               returncode = state3();
                if (returncode == 0)
-               {
-                    current_state = 10;
-                    write_state(current_state);
-               }
+                    return (2);
                else if (returncode != 2)
-               {
-                    state_error(9, __LINE__);
-               } /* else don't do anything and wait again */ 
+                    state_error(3, __LINE__);
           }
+          return (state); /* else don't do anything and wait again */
+     }
+          
+     else if (state == 5) /* variator just terminated,
+                             here you can do what you want */
+     {
+          returncode = state5();/* e.g., terminate too */
+          if (returncode == 0)
+               return (6);
+          else if (returncode != 2)
+               state_error(5, __LINE__);
+          return (state);
+     }
       
-          else if (current_state == 10) /* reset */
+     else if (state == 6) /* stop */
+     {
+          returncode = state6();
+          if (returncode == 0)
           {
-               returncode = state10();
-               if (returncode == 0)
-               {
-                    clean_population();
-                    current_state = 11;
-                    write_state(current_state);
-               }
-               else if (returncode != 2)
-               {
-                    state_error(10, __LINE__);
-               } /* else don't do anything and wait again */ 
+               clean_population();
+               return (7);
           }
+          state_error(6, __LINE__);
+     }
+
+     else if (state == 9) /* variator ready for reset,
+                             here you can do what you want */
+     {
+          returncode = state9();/* e.g., get ready for reset too */
+          if (returncode == 0)
+               return (10);
+          else if (returncode != 2)
+               state_error(9, __LINE__);
+          return (state);
+     }
       
-          else /* state == -1 (reading failed) or state concerns variator */
+     else if (state == 10) /* reset */
+     {
+          returncode = state10();
+          if (returncode == 0)
           {
-               wait(poll);
+               clean_population();
+               return (11);
           }
-     } /* state == 6 (stop) */
-  
-     returncode = state6();
-     if (returncode == 0)
-     {
-          clean_population();
-          current_state=7;
-          write_state(current_state);
+          else if (returncode != 2)
+               state_error(10, __LINE__);
+          return (state);
      }
-     else
-          state_error(6, __LINE__);
-  
-     return (0);
+
+     return (-1);
+}
+
+
+int selector_open(char *param, char *filenamebase, void **memory)
+/* Sets up the selector as main() does, but for running in one program
+   with the variator (see driver_c_source): the state and the data are
+   exchanged through the segment '*memory' in the memory of the program
+   (see open_memory_transport()).
+   Returns 0 if successful and 1 otherwise. */
+{
+     strcpy(paramfile, param);
+     set_file_names(filenamebase);
+     global_population.slot_ind = NULL;
+     read_common_parameters();
+     return (open_memory_transport(memory));
 }
 
 /*-------------------------| populations functions |--------------------*/
@@ -202,9 +453,10 @@ int main(int argc, char *argv[])
    individual */
 individual *get_individual(int identity) 
 {
-     if((identity > global_population.last_identity) || (identity < 0))
+     int slot = find_slot(identity);
+     if (slot == -1)
           return (NULL);
-     return (global_population.individual_array[identity]);
+     return (global_population.slot_ind[slot]);
 }
 
 
@@ -219,20 +471,24 @@ int get_first()
    global population*/
 int get_next(int identity)  
 {
-     int next_id;
+     int slot;
      /* check for valid id */
-     if((identity < -1) || (identity > global_population.last_identity))
-          return (-1); 
-     next_id = identity + 1;
-     while(next_id <= global_population.last_identity)
+     if (identity == -1)
+          slot = global_population.first_live;
+     else
      {
-          /* if pointer is not NULL it is a valid individual */
-          if(global_population.individual_array[next_id] != NULL)
-               return (next_id);
-          next_id++;
+          slot = find_slot(identity);
+          if (slot == -1)
+               return (-1);
+          slot++;
      }
-     /* no individual found in whole population, so return -1 */
-     return (-1);
+     /* skip the slots of removed individuals */
+     while (slot < global_population.used
+            && global_population.slot_ind[slot] == NULL)
+          slot++;
+     if (slot >= global_population.used)
+          return (-1); /* no individual found */
+     return (global_population.slot_id[slot]);
 }
 
 
@@ -247,32 +503,30 @@ int get_size()
    If successful returns 0, and 1 otherwise. */
 int remove_individual(int identity) 
 {
-     int last_id; 
+     int slot;
      individual *temp;
      
      /* check for valid id */
-     if(identity < 0 || identity > global_population.last_identity)
+     slot = find_slot(identity);
+     if (slot == -1)
           return (1);
 
-     temp = global_population.individual_array[identity];
+     temp = global_population.slot_ind[slot];
      /* if individual with given id doesn't exist */
      if(temp == NULL)
           return (1);
 
-     global_population.individual_array[identity] = NULL;
+     /* the slot keeps its identity, so that get_next() still works */
+     global_population.slot_ind[slot] = NULL;
      /* free individual */
      free_individual(temp);
-     /* if the id was the highest one we decrease the last id */
-     if(identity >= global_population.last_identity)
+     /* if it was the first individual, find the new first one */
+     if (slot == global_population.first_live)
      {
-          global_population.last_identity--;
-          last_id = global_population.last_identity;     
-          while(last_id > -1 &&
-                global_population.individual_array[last_id] == NULL)
-          {
-               global_population.last_identity--;
-               last_id = global_population.last_identity;
-          }	      
+          while (global_population.first_live < global_population.used
+                 && global_population.slot_ind[global_population.first_live]
+                    == NULL)
+               global_population.first_live++;
      }
      global_population.size--;
      return (0);
@@ -282,108 +536,88 @@ int remove_individual(int identity)
 /*-------------------------| io |---------------------------------------*/
 
 
-int read_ini(int *id_array)
-/* Reads individuals from var file and updates the global population.
-   The IDs of the individuals are stored in 'id_array'.  The
-   number of IDs in this array is alpha. 'id_array' must be big
-   enough to store alpha 'int' variables.
-
-   If reading is successful function returns 0, otherwise it returns
-   1. */
+static int add_records(int count, int *ids, double *values, int *id_array)
+/* Adds the 'count' individuals with the IDs 'ids' and the objective
+   values 'values' ('dimension' per individual) to the global
+   population and stores their IDs in 'id_array'.
+   Returns 0 if successful and 1 otherwise. */
 {
-     int i, j, size;
-     char tag[4];
-     FILE *fp;
-     int result; /* stores return value of called functions */
-     int identity;
-     double *objective_value;
+     int j;
 
-     objective_value = (double *) malloc(dimension * sizeof(double));
-     if (objective_value == NULL)
+     assert(id_array != NULL);
+     for (j = 0; j < count; j++)
      {
-          log_to_file(log_file, __FILE__, __LINE__,
-                      "Selector out of memory.");
-          exit(EXIT_FAILURE);
+          id_array[j] = ids[j];
+          if (add_individual(ids[j], values + (size_t) j * dimension) != 0)
+               return (1);
      }
-     
-      
-     fp = fopen(ini_file, "r");
-     assert(fp != NULL);
+     return (0);
+}
 
-     assert(id_array != NULL);
-     
-     fscanf(fp, "%d", &size);
-     /* test if size has a valid value */
-     if (size != ((dimension + 1) * alpha))
+
+static int read_shm_records(int area, int count, int *id_array)
+/* Adds the 'count' individuals in 'area' (SHM_INI or SHM_VAR) of the
+   shared memory segment to the global population, stores their IDs in
+   'id_array' and empties the area.
+   Returns 0 if successful and 1 otherwise. */
+{
+     if (get_shm_word(area) != count)
      {
-          log_to_file(log_file, __FILE__, __LINE__, 
-                      "size in ini file is wrong");
-          free(objective_value);
-          fclose(fp);
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "number of records in shared memory is wrong");
           return (1);
      }
-     //debugging
-     //printf("reading population from %s...\n",ini_file);
-     for(j = 0; j < alpha; j++)
-     {
-          
-          /* reading index of individual */
-          result = fscanf(fp, "%d", &identity); /* fscanf() returns EOF
-                                                   if reading fails.*/
-         //printf("ind %i: ",identity);
-         if (result == EOF) /* file not completely written */
-          {
-               free(objective_value);
-               fclose(fp);
-               return (1); /* signalling that reading failed */
-          }
-          id_array[j] = identity;
-          for (i = 0; i < dimension; i++)
-          {
-               /* reading fitness values of ind */
-               result = fscanf(fp, "%le", &objective_value[i]);
-               if (result == EOF) /* file not completely written */
-               {
-                    free(objective_value);
-                    fclose(fp);
-                    return (1); /* signalling that reading failed */
-               }
-           
-               // debug: print objective values that have been gathered
-               //printf("%e ",objective_value[i]);
-          }
+     if (add_records(count, shm_ids(area), shm_values(area), id_array) != 0)
+          return (1);
+     set_shm_word(area, 0);
+     return (0);
+}
 
-          /* adding individual */
-          result = add_individual(identity, objective_value);
-          if (result != 0)
-          {
-               free(objective_value);
-               fclose(fp);
-               return (1);
-          }
-          //printf("\n");
-     }
-     
-     fscanf(fp, "%s", tag);
-     if (strcmp(tag, "END") != 0)
+
+static int read_records(char *filename, int area, int count,
+                        int *id_array)
+/* Adds the 'count' individuals in the ini or var file 'filename', in
+   either format (or in 'area' of the shared memory segment), to the
+   global population, stores their IDs in 'id_array' and then deletes
+   the content of the file.
+   Returns 0 if successful and 1 otherwise. */
+{
+     binary_data data;
+     int result;
+
+     if (transport != TRANSPORT_FILE)
+          return (read_shm_records(area, count, id_array));
+
+     if (read_data(filename, dimension, &data) != 0)
+          return (1); /* file not completely written */
+     if (data.count != count)
      {
-          free(objective_value);
-          fclose(fp);
-          return (1);  /* signalling that reading failed */
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "size in ini or var file is wrong");
+          free(data.buffer);
+          return (1);
      }
-     else /* "END" ok */
-     {
-          fclose(fp);
+     result = add_records(count, data.ids, data.values, id_array);
+     free(data.buffer);
+     if (result != 0)
+          return (1);
 
-          /* deleting content */
-          fp = fopen(ini_file, "w");
-          assert(fp != NULL);
-          fprintf(fp, "%d", 0);
-          fclose(fp);
+     /* deleting content */
+     empty_file(filename);
+     return (0);
+}
 
-          free(objective_value);
-          return (0);  
-     }    
+
+int read_ini(int *id_array)
+/* Reads individuals from ini file and updates the global population.
+   The IDs of the individuals are stored in 'id_array'.  The
+   number of IDs in this array is alpha. 'id_array' must be big
+   enough to store alpha 'int' variables.
+
+   If reading is successful function returns 0, otherwise it returns
+   1. */
+{
+     return (read_records(ini_file, SHM_INI, alpha, id_array));
 }
 
 
@@ -396,89 +630,7 @@ int read_var(int *id_array)
    If reading is successful function returns 0, otherwise it returns
    1. */
 {
-     int i, j, size;
-     char tag[4];
-     FILE *fp;
-     int result;
-     int identity;
-     double *objective_value;
-     
-     objective_value = (double *) malloc(dimension * sizeof(double));
-     if (objective_value == NULL)
-     {
-          log_to_file(log_file, __FILE__, __LINE__,
-                      "Selector out of memory.");
-          exit(EXIT_FAILURE);
-     }
-     fp = fopen(var_file, "r");
-     assert(fp != NULL);
-
-     
-     assert(id_array != NULL);
-     
-     fscanf(fp, "%d", &size);
-     /* test if size has a valid value */
-     if (size != ((dimension + 1) * lambda))
-     {
-          log_to_file(log_file, __FILE__, __LINE__,
-                      "size in var file is wrong");
-          free(objective_value);
-          fclose(fp);
-          return (1);
-     }
-     //printf("reading pop...\n");
-     for(j = 0; j < lambda; j++)
-     {
-          
-          /* reading index of individual */
-          result = fscanf(fp, "%d", &identity); /* fscanf() returns EOF
-                                                   if reading fails.*/     
-          //printf("ind %i: ",identity);
-          id_array[j] = identity;
-          for (i = 0; i < dimension; i++)
-          {
-               /* reading fitness values of ind */
-               result = fscanf(fp, "%le", &objective_value[i]);
-               if (result == EOF) /* file not completely written */
-               {
-                    free(objective_value);
-                    fclose(fp);
-                    return (1); /* signalling that reading failed */
-               }
-               //printf("%e ",objective_value[i]);
-          }
-          //printf("\n");
-          /* adding individual */
-          result = add_individual(identity, objective_value);
-          if (result != 0)
-          {
-               free(objective_value);
-               fclose(fp);
-               return (1);
-          }
-     }
-     
-
-     fscanf(fp, "%s", tag);
-     if (strcmp(tag, "END") != 0)
-     {
-          free(objective_value);
-          fclose(fp);
-          return (1);  /* signalling that reading failed */
-     }
-     else /* "END" ok */
-     {
-          fclose(fp);
-
-          /* deleting content */
-          fp = fopen(var_file, "w");
-          assert(fp != NULL);
-          fprintf(fp, "%d", 0);
-          fclose(fp);
-
-          free(objective_value);
-          return (0);
-     }   
+     return (read_records(var_file, SHM_VAR, lambda, id_array));
 }
 
 
@@ -489,17 +641,14 @@ int write_sel(int *identity)
 {
      FILE *fp;
      int i;
-     int min_valid, max_valid;
+     binary_data data;
 
      if(identity == NULL)
           return (1);
      /* test if identities are valid */
-     min_valid = 0;
-     max_valid = global_population.last_identity;
      for(i = 0; i < mu; i++)
      {
-          if (identity[i] < min_valid || identity[i] > max_valid 
-              || global_population.individual_array[identity[i]] == NULL) 
+          if (get_individual(identity[i]) == NULL) 
           {
                log_to_file(log_file, __FILE__,
                            __LINE__, "bad id, checked in write_sel");
@@ -507,8 +656,23 @@ int write_sel(int *identity)
           } 
      }
 
-     fp = fopen(sel_file, "w");
-     assert(fp != NULL);
+     if (transport != TRANSPORT_FILE)
+     {
+          memcpy(shm_ids(SHM_SEL), identity, mu * sizeof(int));
+          set_shm_word(SHM_SEL, mu);
+          return (0);
+     }
+     if (format == FORMAT_BINARY)
+     {
+          if (new_binary(&data, mu, 0) != 0)
+               return (1);
+          memcpy(data.ids, identity, mu * sizeof(int));
+          return (write_binary(sel_file, &data));
+     }
+
+     fp = begin_file(sel_file);
+     if (fp == NULL)
+          return (1);
      fprintf(fp, "%d\n", mu);  
      //printf("Writing to %s: ",sel_file);
      for (i = 0; i < mu; i++)
@@ -519,8 +683,7 @@ int write_sel(int *identity)
      }
      //printf("\n");
      fprintf(fp, "END");
-     fclose(fp);
-     return (0);
+     return (publish_file(fp, sel_file));
 }
 
 
@@ -530,8 +693,38 @@ int write_arc()
 {
      FILE *fp;
      int identity;
-     fp = fopen(arc_file, "w");
-     assert(fp != NULL);
+     int *ids;
+     int size = 0;
+     binary_data data;
+
+     if (transport != TRANSPORT_FILE)
+     {
+          if (global_population.size > shm_capacity())
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "archive too large for shared memory");
+               return (1);
+          }
+          ids = shm_ids(SHM_ARC);
+          for (identity = get_first(); identity != -1;
+               identity = get_next(identity))
+               ids[size++] = identity;
+          set_shm_word(SHM_ARC, size);
+          return (0);
+     }
+     if (format == FORMAT_BINARY)
+     {
+          if (new_binary(&data, global_population.size, 0) != 0)
+               return (1);
+          for (identity = get_first(); identity != -1;
+               identity = get_next(identity))
+               data.ids[size++] = identity;
+          return (write_binary(arc_file, &data));
+     }
+
+     fp = begin_file(arc_file);
+     if (fp == NULL)
+          return (1);
      fprintf(fp, "%d\n", global_population.size);  
      identity = get_first();
      //printf("writing to %s: ",arc_file);
@@ -544,8 +737,7 @@ int write_arc()
      }
      //printf("\n");
      fprintf(fp, "END");
-     fclose(fp);
-     return (0);
+     return (publish_file(fp, arc_file));
 }
 
 
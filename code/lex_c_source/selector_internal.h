@@ -35,8 +35,8 @@
 /* maximal length of entries in cfg file */
 
 
-#define STANDARD_SIZE 32200  
-/* Start with array of this size for global population */
+#define STANDARD_SIZE 1024  
+/* Start with this many slots for the global population (a power of 2) */
 
 /*---------------| declaration of global variables |-------------------*/
 
@@ -73,16 +73,218 @@ int state_error(int error, int linenumber);
 /* Output an error message. */
 
 int wait(double sec);
-/* Makes the calling process sleep for 'sec' seconds. */
+/* Makes the calling process sleep for 'sec' seconds, or on Linux until
+   the state file (or with the shared memory transport, the segment) is
+   written if that happens earlier. With the socket transport, it
+   answers the monitor meanwhile and returns once the state is set. */
+
+/*-------------------| running in one program |-------------------------*/
+
+/* The driver (driver_c_source) links the selector and the variator
+   into one program and runs their state machines itself, without
+   main(), the state file or the monitor. These two functions are all
+   it calls, and have C linkage so that a C program can call them. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int selector_open(char *param, char *filenamebase, void **memory);
+/* Sets up the selector with the parameter file 'param' and the cfg file
+   of 'filenamebase', exchanging the data through the segment '*memory'
+   (see open_memory_transport()).
+   Returns 0 if successful and 1 otherwise. */
+
+int selector_step(int state);
+/* Does the steps required in 'state'. Returns the next state, 'state'
+   if the step has to be tried again and -1 if 'state' does not concern
+   the selector. */
+
+#ifdef __cplusplus
+}
+#endif
+
+/*-------------------| shared memory transport |------------------------*/
+
+/* With the entry 'transport shm' in the cfg file, the state and the
+   contents of the ini, var, sel and arc files are exchanged through a
+   POSIX shared memory segment instead of the files. The segment is
+   named after the absolute path of the filename base, so the monitor
+   finds it from another directory. It holds one word per file (the
+   state, or the number of records, 0 standing for a file containing
+   only '0') and an area of records (IDs, and objective values for ini
+   and var) per data file. The monitor removes the segment when it
+   terminates. */
+
+#define TRANSPORT_FILE 0 /* exchange through the files (default) */
+#define TRANSPORT_SHM 1  /* exchange through shared memory */
+#define TRANSPORT_SOCKET 2 /* exchange over a socket (see below) */
+
+#define SHM_STA 0 /* words of the segment, and areas for the data files */
+#define SHM_INI 1
+#define SHM_VAR 2
+#define SHM_SEL 3
+#define SHM_ARC 4
+#define SHM_WORDS 5
+
+extern int transport; /* TRANSPORT_FILE, TRANSPORT_SHM or
+                         TRANSPORT_SOCKET */
+
+int open_transport(char *filenamebase);
+/* Reads the cfg file, if it exists yet, and attaches the shared memory
+   segment of 'filenamebase' if it asks for 'transport shm'.
+   Returns 0 if successful and 1 otherwise. */
+
+int get_shm_word(int word);
+/* Returns the word 'word' (SHM_STA ... SHM_ARC) of the segment. */
+
+void set_shm_word(int word, int value);
+/* Sets the word 'word' of the segment and wakes up the processes
+   waiting for a change. Write the records of an area before setting
+   its word. */
+
+int shm_capacity(void);
+/* Returns the number of records an area can hold. */
+
+int *shm_ids(int area);
+/* Returns the IDs of the records in 'area' (SHM_INI ... SHM_ARC). */
+
+double *shm_values(int area);
+/* Returns the objective values of the records in 'area' (SHM_INI or
+   SHM_VAR), 'dimension' values per record. */
+
+int open_memory_transport(void **memory);
+/* Switches to the shared memory transport on a segment in the memory
+   of this process, for running in one program with the variator: on
+   a new segment, stored in '*memory', if '*memory' is NULL, and on the
+   segment '*memory' otherwise. The common parameters must have been
+   read. Returns 0 if successful and 1 otherwise. */
+
+/*-------------------------| socket transport |-------------------------*/
+
+/* With the entry 'transport socket <address>' in the cfg file, the
+   selector keeps the words and areas of the shared memory transport in
+   its own memory, and the monitor reads and writes them over a stream
+   socket, so the selector and the variator can run on other hosts than
+   the monitor. <address> is 'host:port' for TCP or the path of a Unix
+   domain socket (without a ':'). The selector listens on port + 1 of
+   'host' (on all addresses if 'host' is empty) or on the path followed
+   by '.selector', the variator on 'port' or the path followed by
+   '.variator' (see module_address()), so both may be given the same
+   cfg file. A Unix domain socket another process listens on is not
+   taken over. The selector answers the monitor in read_state() and
+   wait(), and wait() returns as soon as the monitor has set the state.
+
+   Each message starts with four 32-bit words: SOCKET_MAGIC, the
+   request (SOCKET_GET, SOCKET_SET or SOCKET_WAIT), the word (SHM_STA
+   ... SHM_ARC) and its value. For the word of an area, the records
+   follow: the IDs as 32-bit words, then for ini and var the objective
+   values as doubles, 'dimension' per record. A GET is answered with the same
+   message carrying the value of the word (and the records); a SET
+   carries the new value and records and is not answered. A WAIT for
+   the state carries the state the monitor has seen and is answered,
+   like a GET, once the selector has written another one; until then
+   the monitor sends nothing else. Both hosts must use the same byte
+   order, which SOCKET_MAGIC checks. */
+
+#define SOCKET_MAGIC 0x4b534950 /* "PISK" */
+#define SOCKET_GET 1  /* read a word, and its records */
+#define SOCKET_SET 2  /* write a word, and its records */
+#define SOCKET_WAIT 3 /* read the state once it has changed */
+
+int close_transport(int block);
+/* With the socket transport, answers the monitor until it closes the
+   connection, which it does when it has read the last state, and then
+   closes the sockets. If 'block' is 0, only the requests already there
+   are answered. Returns 0 once the sockets are closed (at once with the
+   other transports) and 1 if the monitor is still connected. */
+
+/*-------------------------| data files |-------------------------------*/
+
+/* The ini, var, sel and arc files are written to a temporary file
+   (the name with '.tmp' appended) that is renamed into place when it
+   is complete, so a reader never sees a partly written file and does
+   not have to read it again. Readers read a whole file with a single
+   read (read_data()). */
+
+/* #define PISA_FSYNC */ /**** define to fsync() the data files before
+                            renaming them, so that they survive a crash
+                            of the host (Unix only) */
+
+FILE *begin_file(char *filename);
+/* Opens the temporary file for writing the new content of 'filename'.
+   Returns NULL if this fails. */
+
+int publish_file(FILE *fp, char *filename);
+/* Closes 'fp', opened by begin_file(), and renames it to 'filename'.
+   Returns 0 if successful and 1 otherwise. */
+
+void empty_file(char *filename);
+/* Leaves only '0' in the file 'filename'. */
+
+
+/*-------------------------| binary files |-----------------------------*/
+
+/* With the entry 'format binary' in the cfg file, the ini, var, sel and
+   arc files are written in a binary format: the magic "PISB", the
+   number of records, the number of objective values per record (0 in
+   sel and arc files) and an unused word, all 32 bit; then the IDs,
+   padded to a multiple of 8 bytes, and the objective values as
+   doubles, all little-endian. A file is written with a single write.
+   The readers accept both formats, so modules that only know the text
+   format can still be given the text files, and a file emptied by its
+   reader always contains the text '0'. */
+
+#define FORMAT_TEXT 0   /* text files (default) */
+#define FORMAT_BINARY 1 /* binary files */
+
+extern int format; /* format of the files written, FORMAT_TEXT or
+                      FORMAT_BINARY */
+
+typedef struct binary_data_t
+{
+     int count;      /* number of records */
+     int dimension;  /* objective values per record */
+     int *ids;       /* IDs of the records */
+     double *values; /* objective values, 'dimension' per record */
+     char *buffer;   /* the whole file */
+     size_t size;    /* its size in bytes */
+} binary_data;
+
+int new_binary(binary_data *data, int count, int dimension);
+/* Allocates the buffer of 'data' for 'count' records with 'dimension'
+   objective values each and sets up the header; the caller fills in
+   'ids' and 'values'. Returns 0 if successful and 1 otherwise. */
+
+int write_binary(char *filename, binary_data *data);
+/* Writes 'data' to 'filename' and frees its buffer.
+   Returns 0 if successful and 1 otherwise. */
+
+int read_data(char *filename, int dimension, binary_data *data);
+/* Reads the data file 'filename', in either format, into 'data' with a
+   single read of the whole file. 'dimension' is the number of objective
+   values per record, 0 for sel and arc files. Returns 0 if successful
+   (free 'data->buffer' when done) and 1 if the file cannot be read or
+   is not completely written or invalid. */
+
 
 /*-------------------------| global population |------------------------*/
 
-/* pool of all existing individuals */
+/* pool of all existing individuals. Individuals are kept in slots in
+   the order they were added; a removed individual leaves an empty slot
+   (NULL in 'slot_ind') that keeps its identity until the slots are
+   compacted, which only happens when an individual is added to a full
+   array. A hash table maps identities to slots. */
 typedef struct population_t 
 {
-     int size;        /* size of the population */
-     individual **individual_array; /* array of individuals */
-     int last_identity; /* largest identity- needed for memory management */
+     int size;        /* number of individuals in the population */
+     individual **slot_ind; /* individual of each slot, NULL if removed */
+     int *slot_id;    /* identity of each slot */
+     int used;        /* number of slots used since the last compaction */
+     int capacity;    /* number of slots allocated */
+     int first_live;  /* first slot holding an individual, 'used' if none */
+     int *map;        /* open addressing table of slots, -1 if empty */
+     int map_mask;    /* number of entries in 'map' minus 1 */
 } population;
 
 /* the only population we need is */
@@ -97,6 +299,61 @@ int clean_population(void);
 /* Frees memory for all individuals in population and for the global
    population itself. */
 
+int find_slot(int identity);
+/* Returns the slot of the global population last given to 'identity',
+   or -1 if there is none. The slot of a removed individual is found
+   until the slots are compacted. */
+
+
+/*-------------------------| serving several runs |---------------------*/
+
+/* A selector started with several filename bases (see main()) serves
+   all these runs in one process, one state at a time: before a run's
+   state is handled, its copy of the global variables that belong to a
+   run is loaded, and afterwards it is saved again. */
+
+typedef struct run_state_t
+{
+     char filenamebase[FILE_NAME_LENGTH_INTERNAL];
+     int stopped;     /* 1 once the run has been through state 6 */
+     int closed;      /* 1 once its transport is closed as well */
+     int alpha;       /* common parameters */
+     int mu;
+     int lambda;
+     int dimension;
+     char cfg_file[FILE_NAME_LENGTH_INTERNAL]; /* file names */
+     char ini_file[FILE_NAME_LENGTH_INTERNAL];
+     char sel_file[FILE_NAME_LENGTH_INTERNAL];
+     char arc_file[FILE_NAME_LENGTH_INTERNAL];
+     char var_file[FILE_NAME_LENGTH_INTERNAL];
+     char sta_file[FILE_NAME_LENGTH_INTERNAL];
+     population global_population;
+     int transport;
+     int format;
+     int cfg_transport;
+     void *segment;   /* attached segment, if any */
+     int seen_sequence;
+     int listen_fd;   /* sockets of the socket transport */
+     int peer_fd;
+     int wait_value;
+     lex_run user;    /* state kept by selector_user.c */
+} run_state;
+
+void save_run(run_state *run);
+/* Copies the global variables of the current run to 'run'. */
+
+void load_run(run_state *run);
+/* Makes 'run', saved by save_run(), the current run. */
+
+int wait_for_runs(run_state *runs, int number, double sec);
+/* Waits like wait(), but wakes up when the monitor of any of the
+   'number' 'runs' with the socket transport sends a request. */
+
+int watch_state_file(void);
+/* Makes wait() wake up when the state file of the current run is
+   written, as well as the state files of the runs watched before.
+   Returns 0 if successful and 1 if inotify is not available. */
+
 
 /*-------------------------| other functions |-------------------------*/
 
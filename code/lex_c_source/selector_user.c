@@ -27,10 +27,17 @@
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "selector.h"
 #include "selector_user.h"
+#ifdef LEX_X86_KERNELS
+#include <immintrin.h>
+#endif
 
 /*--------------------| global variable definitions |-------------------*/
 
@@ -42,6 +49,115 @@ char *log_file = "lex_error.log"; /**** Changed for LEX. */
 char paramfile[FILE_NAME_LENGTH]; /* file with local parameters */
 
 bool eplex = false;     // whether to use epsilon lexicase (for continuous problems)
+bool dynamic_epsilon = false; // recompute epsilon on the pool at every case
+
+/* per-thread buffers of the selection loop, indexed by thread number */
+lex_scratch *scratch = NULL;
+int scratch_count = 0;
+
+/* min-and-filter kernel used by lex_choose(), picked for the CPU */
+lex_filter_fn lex_filter = NULL;
+
+/* case-prefix cache of the current generation: the root stands for the
+   full starting pool, a node at depth d for the pool that survives the
+   first d cases of a selection event. Nodes are cached up to depth
+   'cache_depth' (0 switches the cache off). */
+lex_node prefix_cache = {NULL, 0, 0, NULL};
+int cache_depth = 2;
+
+int lex_seed = 0;        /* seed from the parameter file */
+long lex_generation = 0; /* number of calls to select_ind() since seeding,
+                            part of the key of every random stream */
+
+/* objective matrix of the population handed to select_ind(). Objective o
+   of the individual in dense slot s is obj_matrix[o * obj_stride + s],
+   slot_identity[s] is the PISA identity of slot s. Columns are padded to
+   whole cache lines and the buffers are reused across generations. */
+double *obj_matrix = NULL;
+int *slot_identity = NULL;
+int obj_stride = 0;
+size_t obj_capacity = 0;
+
+/* how lex_choose() applies the first case of a selection event:
+   FIRST_FILTER_SCAN filters the starting pool like every other case,
+   FIRST_FILTER_SORTED looks the survivors up in obj_order */
+int first_filter = FIRST_FILTER_SCAN;
+
+/* per-objective sort order of the matrix slots, built by select_ind() in
+   FIRST_FILTER_SORTED mode. obj_order[o * obj_stride + r] is the slot with
+   the r-th smallest value of objective o, ties broken by slot. */
+int *obj_order = NULL;
+size_t order_capacity = 0;
+
+/* remove the individuals no selection event can return before
+   selecting, see filter_dominated() */
+bool nd_filter = false;
+
+/* collapse individuals with identical objective vectors into one slot
+   of obj_matrix, see dedup_objective_matrix() */
+bool dedup = true;
+
+/* multiplicities of the slots after deduplication, NULL if the current
+   generation is not deduplicated (else it points to dedup_weight). The
+   identities of the individuals in slot s are
+   member_ids[member_start[s] .. member_start[s + 1]). */
+int *slot_weight = NULL;
+int *dedup_weight = NULL;
+int *member_start = NULL;
+int *member_ids = NULL;
+int dedup_capacity = 0;
+
+/* down-sampled lexicase: if positive and smaller than the number of
+   objectives (individuals), each selection event uses only this many of
+   its shuffled cases (a random subsample of this many individuals) */
+int downsample_cases = 0;
+int downsample_pool = 0;
+
+/* if positive, the number of individual-case comparisons a generation may
+   spend on filtering, shared equally by the mu selection events. An event
+   that would exceed its share stops before the next case and picks among
+   the individuals it has left. */
+long work_budget = 0;
+
+/* steady state: if positive, the population selected from slides, every
+   generation adds the offspring and drops the oldest individuals beyond
+   this many (0: the offspring replace the population). window_ids holds
+   the identities of the individuals in the window, oldest first. */
+int window = 0;
+int *window_ids = NULL;
+int window_count = 0;
+int window_capacity = 0;
+
+/* counters of the last call to select_ind() */
+lex_stats last_stats = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+/* if not empty, select_ind() appends one line of statistics per
+   generation to this file, see write_stats() */
+char stats_file[FILE_NAME_LENGTH] = "";
+
+/* set by select_ind() for the current generation: whether the first case
+   uses obj_order, whether the events start from a subsample of the
+   population, and the share of work_budget per event (0: unlimited) */
+bool use_sorted_first = false;
+bool use_pool_sample = false;
+long event_budget = 0;
+
+/* if positive and smaller than the population, epsilon is estimated from
+   this many randomly drawn values of each objective */
+int epsilon_sample = 0;
+
+/* with epsilon 0, selection events whose pool has at most 'fast_lexmin'
+   slots are finished by one streaming pass for the lexicographic minimum
+   instead of filtering case by case (0 switches this off) */
+int fast_lexmin = 64;
+
+/* two slabs holding the individuals and objective vectors of the global
+   population. begin_generation() switches to the other slab and empties
+   it, so the individuals of a generation are allocated contiguously and
+   released in one step; individuals created beyond the capacity of the
+   slab are malloc()ed one by one. */
+lex_slab slabs[2] = {{NULL, NULL, 0, 0, 0, 0}, {NULL, NULL, 0, 0, 0, 0}};
+int current_slab = 0;
 /*-------------------------| individual |-------------------------------*/
 int set_objective_value(individual *ind, int index, double obj_value)
 /* Sets the objective_value of an individual.
@@ -74,10 +190,23 @@ individual *create_individual()
 {
      /**********| added for LEX |**************/
      double *obj_value;
+     lex_slab *slab = &slabs[current_slab];
      /**********| addition for LEX end |*******/
 
      individual *return_ind;
 
+     /**********| added for LEX |**************/
+     if (slab->used < slab->capacity && slab->dimension >= dimension)
+     {
+          return_ind = &slab->inds[slab->used];
+          return_ind->objective_value =
+               slab->values + (size_t) slab->used * slab->dimension;
+          slab->used++;
+          slab->live++;
+          return (return_ind);
+     }
+     /**********| addition for LEX end |*******/
+
      return_ind = (individual *) malloc(sizeof(individual));
      if (return_ind == NULL)
      {
@@ -109,6 +238,12 @@ void free_individual(individual* ind)
 */
 {
      /**********| added for LEX |**************/
+     for (int k = 0; k < 2; ++k)
+          if (ind >= slabs[k].inds && ind < slabs[k].inds + slabs[k].used)
+          {
+               slabs[k].live--; /* released with the slab */
+               return;
+          }
      free(ind->objective_value);
      /**********| addition for LEX end |*******/
      
@@ -116,6 +251,140 @@ void free_individual(individual* ind)
 }
 
 
+/**********| added for LEX |**************/
+
+int begin_generation(int count)
+/* Prepares the allocation of the individuals of a new generation.
+
+   post: The current slab is empty, with room for 'count' individuals of
+         'dimension' objectives: the current slab if none of its
+         individuals is alive (e.g. in state 1), otherwise the other
+         one. The individuals of the previous generation are left alone.
+         If both slabs hold live individuals nothing changes and further
+         individuals come from the rest of the current slab or malloc().
+         return value is 0 if successful and 1 otherwise.
+*/
+{
+     int target = current_slab;
+     lex_slab *slab;
+
+     if (slabs[target].live != 0)
+          target = 1 - target;
+     if (slabs[target].live != 0)
+          return (0);
+     current_slab = target;
+     slab = &slabs[target];
+     slab->used = 0;
+     if (slab->capacity < count || slab->dimension < dimension)
+     {
+          int capacity = std::max(count, slab->capacity);
+          int dim = std::max(dimension, slab->dimension);
+          free(slab->inds);
+          free(slab->values);
+          slab->inds = (individual *) malloc(capacity * sizeof(individual));
+          slab->values = (double *)
+               malloc((size_t) capacity * dim * sizeof(double));
+          slab->capacity = capacity;
+          slab->dimension = dim;
+          if (slab->inds == NULL || slab->values == NULL)
+          {
+               free(slab->inds);
+               free(slab->values);
+               slab->inds = NULL;
+               slab->values = NULL;
+               slab->capacity = slab->dimension = 0;
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               return (1);
+          }
+     }
+     return (0);
+}
+
+
+void free_slabs()
+/* Frees both slabs.
+
+   pre: No individual of the global population lives in a slab.
+*/
+{
+     for (int k = 0; k < 2; ++k)
+     {
+          free(slabs[k].inds);
+          free(slabs[k].values);
+          slabs[k].inds = NULL;
+          slabs[k].values = NULL;
+          slabs[k].capacity = slabs[k].dimension = 0;
+          slabs[k].used = slabs[k].live = 0;
+     }
+}
+
+
+int slide_window(int count, int *ids)
+/* Adds the 'count' individuals 'ids' to the window and removes the
+   oldest individuals beyond 'window' from the global population.
+
+   post: window_ids holds the identities of the newest 'window'
+         individuals, oldest first.
+         return value is 0 if successful and 1 otherwise.
+*/
+{
+     int drop;
+
+     if (window_count + count > window_capacity)
+     {
+          int capacity = std::max(window_count + count, 2 * window_capacity);
+          int *grown = (int *) realloc(window_ids, capacity * sizeof(int));
+          if (grown == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               return (1);
+          }
+          window_ids = grown;
+          window_capacity = capacity;
+     }
+     memcpy(window_ids + window_count, ids, count * sizeof(int));
+     window_count += count;
+     drop = std::max(window_count - window, 0);
+     for (int i = 0; i < drop; ++i)
+          remove_individual(window_ids[i]);
+     memmove(window_ids, window_ids + drop,
+             (window_count - drop) * sizeof(int));
+     window_count -= drop;
+     return (0);
+}
+
+
+void save_lex_run(lex_run *run)
+/* Copies the state of the current run to 'run'. */
+{
+     run->generation = lex_generation;
+     run->slabs[0] = slabs[0];
+     run->slabs[1] = slabs[1];
+     run->current_slab = current_slab;
+     run->window_ids = window_ids;
+     run->window_count = window_count;
+     run->window_capacity = window_capacity;
+}
+
+
+void load_lex_run(lex_run *run)
+/* Makes 'run', saved by save_lex_run(), the current run. The state of
+   the run that was current before must have been saved. */
+{
+     lex_generation = run->generation;
+     slabs[0] = run->slabs[0];
+     slabs[1] = run->slabs[1];
+     current_slab = run->current_slab;
+     window_ids = run->window_ids;
+     window_count = run->window_count;
+     window_capacity = run->window_capacity;
+}
+
+/**********| addition for LEX end |*******/
+
+
 /*-------------------------| statemachine functions |-------------------*/
 
 int state1() 
@@ -165,6 +434,8 @@ int state1()
           log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
           return (1);
      }
+     if (begin_generation(alpha) != 0)
+          return (1);
      printf("read_ini\n");
      result = read_ini(result_identities);   /* read ini file */
      if (result == 1)
@@ -180,8 +451,17 @@ int state1()
      
      /**********| added for LEX |**************/
      printf("select_ind\n");
-     result = select_ind(alpha, result_identities,
-                         PISA_identities, dimension); /* changedddd */
+     if (window > 0) /* steady state */
+     {
+          window_count = 0;
+          if (slide_window(alpha, result_identities) != 0)
+               return (1);
+          result = select_ind(window_count, window_ids,
+                              PISA_identities, dimension);
+     }
+     else
+          result = select_ind(alpha, result_identities,
+                              PISA_identities, dimension); /* changedddd */
 
      if (result != 0)
      {
@@ -254,6 +534,10 @@ int state3()
           return (1);
      }
 
+     /* the offspring go to the other slab, the archive is still needed
+        until it is removed below */
+     if (begin_generation(lambda) != 0)
+          return (1);
      //printf("read_var\n");
      result = read_var(offspring_identities);
      if (result == 1) /* if some file reading error occurs, return 2 */
@@ -261,13 +545,22 @@ int state3()
 
      /**********| added for LEX |**************/
 
-     // clear old global population 
-     for (unsigned i = 0; i < current_arc.size(); -++i)
-         remove_individual(current_arc[i]);
-    
-     
-     result = select_ind(lambda, offspring_identities,
-                         parent_identities, dimension);
+     if (window > 0) // steady state: slide the population
+     {
+          if (slide_window(lambda, offspring_identities) != 0)
+               return (1);
+          result = select_ind(window_count, window_ids,
+                              parent_identities, dimension);
+     }
+     else
+     {
+          // clear old global population 
+          for (unsigned i = 0; i < current_arc.size(); -++i)
+              remove_individual(current_arc[i]);
+
+          result = select_ind(lambda, offspring_identities,
+                              parent_identities, dimension);
+     }
      
      if (result != 0)
      {
@@ -336,6 +629,11 @@ int state6()
           remove_individual(current_id);
           current_id = get_next(current_id);
      }
+     free_slabs();
+     free_selection_buffers();
+     free(window_ids);
+     window_ids = NULL;
+     window_count = window_capacity = 0;
      return (0);
 }
 
@@ -369,6 +667,7 @@ int state10()
 */
 {
    /* freeing memory is done in selector.c */
+   window_count = 0;
    return (0);
 }
 
@@ -398,7 +697,7 @@ int read_local_parameters()
 
      int result;
      char str[CFG_NAME_LENGTH];
-     int seed, tmpep;
+     int tmpep;
      
      /* reading parameter file with parameters for selection */
      fp = fopen(paramfile, "r"); 
@@ -406,11 +705,12 @@ int read_local_parameters()
 
      fscanf(fp, "%s", str);
      assert(strcmp(str, "seed") == 0);
-     result = fscanf(fp, "%e", &seed); /* fscanf() returns EOF if
-                                          reading fails. */
+     result = fscanf(fp, "%d", &lex_seed); /* fscanf() returns EOF if
+                                              reading fails. */
      assert(result != EOF); /* no EOF, 'seed' correctly read */
      
-     srand(seed); /* seeding random number generator */
+     lex_generation = 0; /* restart all random streams */
+     stats_file[0] = '\0';
 
      fscanf(fp, "%s", str);
      assert(strcmp(str, "epsilon") == 0);
@@ -418,8 +718,80 @@ int read_local_parameters()
                                           reading fails. */
      assert(result != EOF); /* no EOF, 'seed' correctly read */
      
+     assert(tmpep >= 0 && tmpep <= 2);
      eplex = tmpep; 
+     dynamic_epsilon = (tmpep == 2);
      //printf("eplex: %i\n",eplex);
+
+     /* optional parameters, in any order */
+     while (fscanf(fp, "%s", str) == 1)
+     {
+          if (strcmp(str, "cache_depth") == 0)
+          {
+               result = fscanf(fp, "%d", &cache_depth);
+               assert(result == 1 && cache_depth >= 0);
+          }
+          else if (strcmp(str, "fast_lexmin") == 0)
+          {
+               result = fscanf(fp, "%d", &fast_lexmin);
+               assert(result == 1 && fast_lexmin >= 0);
+          }
+          else if (strcmp(str, "nd_filter") == 0)
+          {
+               result = fscanf(fp, "%d", &tmpep);
+               assert(result == 1);
+               nd_filter = tmpep;
+          }
+          else if (strcmp(str, "dedup") == 0)
+          {
+               result = fscanf(fp, "%d", &tmpep);
+               assert(result == 1);
+               dedup = tmpep;
+          }
+          else if (strcmp(str, "downsample_cases") == 0)
+          {
+               result = fscanf(fp, "%d", &downsample_cases);
+               assert(result == 1 && downsample_cases >= 0);
+          }
+          else if (strcmp(str, "downsample_pool") == 0)
+          {
+               result = fscanf(fp, "%d", &downsample_pool);
+               assert(result == 1 && downsample_pool >= 0);
+          }
+          else if (strcmp(str, "work_budget") == 0)
+          {
+               result = fscanf(fp, "%ld", &work_budget);
+               assert(result == 1 && work_budget >= 0);
+          }
+          else if (strcmp(str, "window") == 0)
+          {
+               result = fscanf(fp, "%d", &window);
+               assert(result == 1 && window >= 0);
+          }
+          else if (strcmp(str, "epsilon_sample") == 0)
+          {
+               result = fscanf(fp, "%d", &epsilon_sample);
+               assert(result == 1 && epsilon_sample >= 0);
+          }
+          else if (strcmp(str, "stats_file") == 0)
+          {
+               result = fscanf(fp, "%s", stats_file);
+               assert(result == 1);
+          }
+          else if (strcmp(str, "first_filter") == 0)
+          {
+               result = fscanf(fp, "%d", &first_filter);
+               assert(result == 1 && (first_filter == FIRST_FILTER_SCAN
+                                      || first_filter == FIRST_FILTER_SORTED));
+          }
+          else
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "unknown parameter in parameter file");
+               fclose(fp);
+               return (1);
+          }
+     }
      fclose(fp);
   
      /* do some other initialization steps... */
@@ -427,6 +799,16 @@ int read_local_parameters()
 }
 
 
+/* wall clock time in seconds */
+static double lex_clock()
+{
+#ifdef _OPENMP
+     return (omp_get_wtime());
+#else
+     return ((double) clock() / CLOCKS_PER_SEC);
+#endif
+}
+
 /* Implements LEX. Takes size individual from variation, updates global
    population and selects mu new individual for variation. */
 int select_ind(int size, int *population, int *parents,
@@ -441,230 +823,1163 @@ int select_ind(int size, int *population, int *parents,
      //printf("select_ind...\n");
      //printf("size:%i\n",size);
      assert(dimension >= 0);
+     int population_size = size;
+     double start_time = lex_clock();
+     double * epsilon = NULL;
+     int * start_pool = NULL;
+     long generation;
+     double epsilon_time, select_time;
+     int cases_used;
+     bool whole_events;
+     int result = 1;
+     /* gather the objective values once per generation */
+     if (build_objective_matrix(size, population, dimension) != 0)
+          goto cleanup;
+
      // if continuous objectives, calculate epsilon
-     double * epsilon = (double *) malloc(dimension * sizeof(double));
+     epsilon = (double *) malloc(dimension * sizeof(double));
+     start_pool = (int *) malloc(size * sizeof(int));
+     if (epsilon == NULL || start_pool == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          goto cleanup;
+     }
+     if (prepare_scratch(size, dimension) != 0)
+          goto cleanup;
+     generation = lex_generation++;
+     epsilon_time = lex_clock();
      if (eplex){
          //printf("calculating epsilon\n"); 
-         calculate_epsilon(population, size, dimension, epsilon);
+         calculate_epsilon(size, dimension, epsilon, generation);
      }
      else{
          //printf("setting epsilon to zero\n"); 
          for (int i =0; i<dimension; ++i)
              epsilon[i] = 0;
      }
+     epsilon_time = lex_clock() - epsilon_time;
+     // events starting from a subsample of individuals cannot share
+     // prefixes or sort orders, and must see every individual on its own
+     use_pool_sample = (downsample_pool > 0 && downsample_pool < size);
+     use_sorted_first = (first_filter == FIRST_FILTER_SORTED
+                         && !use_pool_sample);
+     cases_used = dimension;
+     if (downsample_cases > 0 && downsample_cases < dimension)
+          cases_used = downsample_cases;
+     event_budget = 0;
+     if (work_budget > 0)
+          event_budget = std::max(work_budget / std::max(mu, 1), 1L);
+     // both reductions below hold only if every event applies all cases
+     // to all individuals; a budget would also count slots, not
+     // individuals
+     whole_events = (cases_used == dimension && event_budget == 0);
+     // drop the individuals no selection event can return; with dynamic
+     // epsilon they still count for the epsilon of the pools
+     if (nd_filter && !dynamic_epsilon && !use_pool_sample && whole_events)
+     {
+          size = filter_dominated(size, dimension, epsilon);
+          if (size < 0)
+               goto cleanup;
+     }
+     // select among distinct objective vectors, weighted by their number
+     slot_weight = NULL;
+     if (dedup && !dynamic_epsilon && !use_pool_sample && whole_events)
+     {
+          size = dedup_objective_matrix(size, dimension);
+          if (size < 0)
+               goto cleanup;
+     }
+     if (use_sorted_first && build_objective_order(size, dimension) != 0)
+          goto cleanup;
+     // every selection event starts from all slots of the matrix
+     for (int s = 0; s < size; ++s)
+         start_pool[s] = s;
      
-     //printf("%i: population semantics:\n---\n",__LINE__);
-     //for (int i = 0; i < get_size(); ++i)
-     //{
-     //    printf("ind %i:\t",population[i]);
-     //    for (int j = 0; j < dimension; ++j)
-     //       printf("%e,",get_objective_value(population[i],j));    
-     //    printf("\n");
-     //}
-     //printf("---\nmin:\t");
-     //std::vector<int> pop(mu);
-     //std::iota(pop.begin(),pop.end(),0);
-     //for (int i = 0; i<dimension; ++i)
-     //    printf("%e,",min_obj(pop,i));
-     //
-     //printf("\n---\nep:\t");
-     //for (int i = 0; i<dimension; ++i)
-     //    printf("%e,",epsilon[i]);
-     //printf("\n---\n");
-     //printf("starting selection...\n");
-     
-     /* choose mu individuals by lexicase selection */
-     #pragma omp parallel for   
-     for(int i = 0; i < mu; i++)
-     {
-         //printf("selection %i\n",i);
-         // cases, i.e. objectives, to consider each selection event
-         int *cases = (int *) malloc(dimension * sizeof(int));
-         for (int i = 0; i<dimension; ++i)
-            cases[i] = i;                
-         // shuffle objectives
-         shuffle(cases, dimension);
-         int pos = lex_choose(population, size, cases, dimension, epsilon);
-        // if (pos == -1) /* Choosing failed. */
-        //      return (1);
-         parents[i] = pos;
-         free(cases);
+     if (!use_pool_sample && open_prefix_cache(dimension) != 0)
+          goto cleanup;
+     if (lex_filter == NULL)
+          lex_filter = choose_filter_kernel();
+
+     for (int t = 0; t < scratch_count; ++t)
+     {
+          scratch[t].cases_used = scratch[t].work = 0;
+          scratch[t].max_cases = scratch[t].final_pool = 0;
+          if (stats_file[0] != '\0')
+               memset(scratch[t].decay, 0, (dimension + 1) * sizeof(long));
+     }
+     select_time = lex_clock();
+
+     /* choose mu individuals by lexicase selection. Each selection event
+        draws from its own random stream, so the parents do not depend on
+        the number of threads or on their scheduling. */
+     #pragma omp parallel
+     {
+         lex_scratch *own = &scratch[lex_thread_num()];
+         #pragma omp for
+         for(int i = 0; i < mu; i++)
+         {
+             //printf("selection %i\n",i);
+             lex_rng rng;
+             rng_init(&rng, generation, i);
+             // cases, i.e. objectives, to consider each selection event
+             for (int c = 0; c<dimension; ++c)
+                own->cases[c] = c;
+             // shuffle objectives
+             shuffle(&rng, own->cases, dimension);
+             int slot;
+             if (use_pool_sample)
+             {
+                 // start from a random subsample, drawn by a partial
+                 // shuffle of all slots
+                 memcpy(own->pool, start_pool, size * sizeof(int));
+                 for (int k = 0; k < downsample_pool; ++k)
+                 {
+                     int j = k + irand(&rng, size - k);
+                     int t = own->pool[j];
+                     own->pool[j] = own->pool[k];
+                     own->pool[k] = t;
+                 }
+                 slot = lex_choose(own, own->pool, downsample_pool,
+                                   cases_used, epsilon, &rng);
+             }
+             else
+                 slot = lex_choose(own, start_pool, size, cases_used,
+                                   epsilon, &rng);
+             if (slot_weight != NULL) // any individual of the slot
+                 parents[i] = member_ids[member_start[slot]
+                                         + irand(&rng, slot_weight[slot])];
+             else
+                 parents[i] = slot_identity[slot];
+         }
+     }
+     select_time = lex_clock() - select_time;
+     close_prefix_cache();
+     last_stats.events = mu;
+     last_stats.cases = last_stats.work = 0;
+     last_stats.max_cases = last_stats.final_pool = 0;
+     for (int t = 0; t < scratch_count; ++t)
+     {
+          last_stats.cases += scratch[t].cases_used;
+          last_stats.work += scratch[t].work;
+          last_stats.final_pool += scratch[t].final_pool;
+          last_stats.max_cases = std::max(last_stats.max_cases,
+                                          scratch[t].max_cases);
+     }
+     last_stats.epsilon_time = epsilon_time;
+     last_stats.select_time = select_time;
+     last_stats.prepare_time = lex_clock() - start_time - epsilon_time
+                               - select_time;
+     // telemetry must not stop the run, write_stats() logs its errors
+     if (stats_file[0] != '\0')
+          write_stats(generation, population_size,
+                      use_pool_sample ? downsample_pool : size, cases_used,
+                      parents);
+     result = 0;
+
+cleanup:
+     // after an error the run ends, so the buffers kept across
+     // generations go as well
+     if (result != 0)
+          free_selection_buffers();
+     free(start_pool);
+     free(epsilon);
+     return (result);
+}
+
+void free_selection_buffers()
+/* Frees the objective matrix, the sort orders and the deduplication
+   buffers that select_ind() keeps across generations. */
+{
+     free(obj_matrix);
+     free(slot_identity);
+     free(obj_order);
+     free(dedup_weight);
+     free(member_start);
+     free(member_ids);
+     obj_matrix = NULL;
+     slot_identity = NULL;
+     obj_order = NULL;
+     slot_weight = dedup_weight = member_start = member_ids = NULL;
+     obj_capacity = order_capacity = 0;
+     dedup_capacity = 0;
+}
+
+int build_objective_matrix(int size, int *ids, int dimension)
+{
+     /* Copies the objective values of individuals 'ids' into obj_matrix,
+        slot s holding ids[s]. Returns 0 if successful and 1 otherwise. */
+     int stride = (size + OBJ_MATRIX_PAD - 1) / OBJ_MATRIX_PAD
+                  * OBJ_MATRIX_PAD;
+     size_t needed = (size_t) stride * dimension;
+
+     if (needed > obj_capacity || slot_identity == NULL)
+     {
+          free(obj_matrix);
+          free(slot_identity);
+          obj_matrix = NULL;
+#ifdef PISA_UNIX
+          if (posix_memalign((void **) &obj_matrix, OBJ_MATRIX_ALIGN,
+                             needed * sizeof(double)) != 0)
+               obj_matrix = NULL;
+#else
+          obj_matrix = (double *) malloc(needed * sizeof(double));
+#endif
+          slot_identity = (int *) malloc(stride * sizeof(int));
+          if (obj_matrix == NULL || slot_identity == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               obj_capacity = 0;
+               return (1);
+          }
+          obj_capacity = needed;
+     }
+     obj_stride = stride;
+
+     for (int s = 0; s < size; ++s)
+     {
+          individual *ind = get_individual(ids[s]);
+          if (ind == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "unknown identity in objective matrix");
+               return (1);
+          }
+          slot_identity[s] = ids[s];
+          for (int o = 0; o < dimension; ++o)
+               obj_matrix[(size_t) o * stride + s] = ind->objective_value[o];
      }
      return (0);
 }
-void calculate_epsilon(int *ids, int popsize, int dimension, double *epsilon)
+
+static unsigned long long mix64(unsigned long long x);
+
+/* hash of the objective vector in 'slot'; -0.0 hashes like 0.0 since
+   the two compare equal */
+static unsigned long long slot_hash(int slot, int dimension)
 {
-    // calculate median absolute deviation (MAD) of each objective across the population
+     unsigned long long h = 0;
+     for (int o = 0; o < dimension; ++o)
+     {
+          double f = obj_matrix[(size_t) o * obj_stride + slot] + 0.0;
+          unsigned long long bits;
+          memcpy(&bits, &f, sizeof(bits));
+          h = mix64(h ^ bits);
+     }
+     return (h);
+}
+
+/* whether slots a and b hold the same objective vector */
+static bool same_vector(int a, int b, int dimension)
+{
+     for (int o = 0; o < dimension; ++o)
+     {
+          const double *col = obj_matrix + (size_t) o * obj_stride;
+          if (col[a] != col[b])
+               return (false);
+     }
+     return (true);
+}
+
+int dedup_objective_matrix(int size, int dimension)
+{
+     /* Collapses the slots of obj_matrix with identical objective vectors
+        into the slot of their first occurrence and compacts the distinct
+        slots to the front in their original order. slot_weight gets the
+        number of individuals of each slot, member_ids their identities.
+        Duplicates always survive the same cases, so lexicase over the
+        distinct slots, with the final pick weighted by slot_weight and
+        followed by a uniform pick of a member, selects every individual
+        with the same probability as before. Returns the number of
+        distinct slots, or -1 if memory ran out. */
+     int buckets = 2;
+     while (buckets < 2 * size)
+          buckets *= 2;
+     int *table = (int *) malloc(buckets * sizeof(int));
+     int *unique_of = (int *) malloc(size * sizeof(int));
+     if (size > dedup_capacity)
+     {
+          free(dedup_weight);
+          free(member_start);
+          free(member_ids);
+          dedup_weight = (int *) malloc(size * sizeof(int));
+          member_start = (int *) malloc((size + 1) * sizeof(int));
+          member_ids = (int *) malloc(size * sizeof(int));
+          dedup_capacity = size;
+     }
+     if (table == NULL || unique_of == NULL || dedup_weight == NULL
+         || member_start == NULL || member_ids == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          free(table);
+          free(unique_of);
+          free(dedup_weight);
+          free(member_start);
+          free(member_ids);
+          dedup_weight = member_start = member_ids = NULL;
+          dedup_capacity = 0;
+          return (-1);
+     }
+
+     /* number the distinct vectors in order of their first occurrence */
+     for (int b = 0; b < buckets; ++b)
+          table[b] = -1;
+     int unique = 0;
+     for (int s = 0; s < size; ++s)
+     {
+          int b = (int) (slot_hash(s, dimension) & (buckets - 1));
+          while (table[b] != -1 && !same_vector(table[b], s, dimension))
+               b = (b + 1) & (buckets - 1);
+          if (table[b] == -1)
+          {
+               table[b] = s;
+               dedup_weight[unique] = 0;
+               unique_of[s] = unique++;
+          }
+          else
+               unique_of[s] = unique_of[table[b]];
+          dedup_weight[unique_of[s]]++;
+     }
+
+     /* members of each distinct vector, in slot order */
+     member_start[0] = 0;
+     for (int u = 0; u < unique; ++u)
+          member_start[u + 1] = member_start[u] + dedup_weight[u];
+     for (int s = size - 1; s >= 0; --s)
+     {
+          int u = unique_of[s];
+          member_ids[member_start[u] + --dedup_weight[u]] = slot_identity[s];
+     }
+     for (int u = 0; u < unique; ++u)
+          dedup_weight[u] = member_start[u + 1] - member_start[u];
+
+     /* keep the first occurrences; unique_of[s] == u marks the first */
+     int kept = 0;
+     for (int s = 0; s < size; ++s)
+     {
+          if (unique_of[s] != kept)
+               continue;
+          for (int o = 0; o < dimension; ++o)
+          {
+               double *col = obj_matrix + (size_t) o * obj_stride;
+               col[kept] = col[s];
+          }
+          slot_identity[kept] = slot_identity[s];
+          kept++;
+     }
+     free(table);
+     free(unique_of);
+     slot_weight = dedup_weight;
+     return (unique);
+}
+
+/* orders slots lexicographically by all columns of obj_matrix */
+struct slot_lex_less
+{
+     int dimension;
+     bool operator()(int a, int b) const
+     {
+          for (int o = 0; o < dimension; ++o)
+          {
+               const double *col = obj_matrix + (size_t) o * obj_stride;
+               if (col[a] != col[b])
+                    return (col[a] < col[b]);
+          }
+          return (a < b);
+     }
+};
+
+int filter_dominated(int size, int dimension, const double *epsilon)
+{
+     /* Removes from obj_matrix every slot x for which some slot y is at
+        least as good in all objectives and better by more than
+        epsilon[o] in some objective o. Whenever x survives a case, so
+        does y, and x is filtered out at case o at the latest: x can
+        neither be the last one left nor a final survivor, and since y
+        stays, removing x changes no minimum. The selection events thus
+        return the same slots with or without x.
+
+        Slots are visited in lexicographic order, so every dominating slot
+        comes first. Domination with margin is transitive, so comparing
+        with the kept slots suffices. The kept slots are compacted to the
+        front of obj_matrix and slot_identity in their original order;
+        their number is returned, or -1 if memory ran out. */
+     int *order = (int *) malloc(size * sizeof(int));
+     int *front = (int *) malloc(size * sizeof(int));
+     char *keep = (char *) malloc(size * sizeof(char));
+     if (order == NULL || front == NULL || keep == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          free(order);
+          free(front);
+          free(keep);
+          return (-1);
+     }
+
+     slot_lex_less less = {dimension};
+     for (int s = 0; s < size; ++s)
+          order[s] = s;
+     std::sort(order, order + size, less);
+
+     int front_size = 0;
+     for (int r = 0; r < size; ++r)
+     {
+          int x = order[r];
+          keep[x] = 1;
+          for (int f = 0; f < front_size && keep[x]; ++f)
+          {
+               int y = front[f];
+               bool weak = true, margin = false;
+               for (int o = 0; o < dimension && weak; ++o)
+               {
+                    const double *col = obj_matrix + (size_t) o * obj_stride;
+                    weak = (col[y] <= col[x]);
+                    margin = margin || (col[y] + epsilon[o] < col[x]);
+               }
+               if (weak && margin)
+                    keep[x] = 0;
+          }
+          if (keep[x])
+               front[front_size++] = x;
+     }
+
+     for (int o = 0; o < dimension; ++o)
+     {
+          double *col = obj_matrix + (size_t) o * obj_stride;
+          int kept = 0;
+          for (int s = 0; s < size; ++s)
+          {
+               col[kept] = col[s];
+               kept += keep[s];
+          }
+     }
+     int kept = 0;
+     for (int s = 0; s < size; ++s)
+     {
+          slot_identity[kept] = slot_identity[s];
+          kept += keep[s];
+     }
+     free(order);
+     free(front);
+     free(keep);
+     return (kept);
+}
+
+/* orders slots by their value in one column of obj_matrix */
+struct slot_less
+{
+     const double *col;
+     bool operator()(int a, int b) const
+     {
+          return (col[a] < col[b] || (col[a] == col[b] && a < b));
+     }
+};
+
+int build_objective_order(int size, int dimension)
+{
+     /* Sorts the slots of obj_matrix by each objective into obj_order.
+        Returns 0 if successful and 1 otherwise. */
+     size_t needed = (size_t) obj_stride * dimension;
+
+     if (needed > order_capacity)
+     {
+          free(obj_order);
+          obj_order = (int *) malloc(needed * sizeof(int));
+          if (obj_order == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               order_capacity = 0;
+               return (1);
+          }
+          order_capacity = needed;
+     }
+
+     #pragma omp parallel for
+     for (int o = 0; o < dimension; ++o)
+     {
+          int *order = obj_order + (size_t) o * obj_stride;
+          slot_less less = {obj_matrix + (size_t) o * obj_stride};
+          for (int s = 0; s < size; ++s)
+               order[s] = s;
+          std::sort(order, order + size, less);
+     }
+     return (0);
+}
+
+void calculate_epsilon(int popsize, int dimension, double *epsilon,
+                       long generation)
+{
+    // calculate median absolute deviation (MAD) of each objective across
+    // the population, each thread working in its own scratch buffer
+    int samples = popsize;
+    if (epsilon_sample > 0 && epsilon_sample < popsize)
+        samples = epsilon_sample;
+
+    #pragma omp parallel for schedule(dynamic)
     for (int i  = 0; i < dimension; ++i)
     {
         //printf("calc epsilon for dimension %i...\n",i);
-        std::vector<double> objs;
-        for (int j = 0; j<popsize; ++j)
-            objs.push_back( get_objective_value(j,i) );
-        //printf("epsilon[%i] = %e..\n",i,mad(objs));
-        epsilon[i] = mad(objs);
+        const double *col = obj_matrix + (size_t) i * obj_stride;
+        double *values = scratch[lex_thread_num()].values;
+        if (samples == popsize)
+            memcpy(values, col, popsize * sizeof(double));
+        else
+        {
+            // estimate from a random sample, drawn from a stream of its
+            // own so that the estimate does not depend on the threads
+            lex_rng rng;
+            rng_init(&rng, generation, -1 - (long) i);
+            for (int k = 0; k < samples; ++k)
+                values[k] = col[irand(&rng, popsize)];
+        }
+        epsilon[i] = mad(values, samples);
+        //printf("epsilon[%i] = %e..\n",i,epsilon[i]);
     }
 
 }
 
-/// calculate median
-double median(const std::vector<double>& v) 
+int prepare_scratch(int size, int dimension)
+{
+     /* Makes sure every thread has pool and value buffers for 'size'
+        slots and case and pool decay buffers for 'dimension' cases. The
+        buffers only grow, so a run allocates them once. Returns 0 if
+        successful and 1 otherwise. */
+     int threads = 1;
+#ifdef _OPENMP
+     threads = omp_get_max_threads();
+#endif
+     if (threads > scratch_count)
+     {
+          lex_scratch *tmp = (lex_scratch *)
+               realloc(scratch, threads * sizeof(lex_scratch));
+          if (tmp == NULL)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               return (1);
+          }
+          scratch = tmp;
+          for (int t = scratch_count; t < threads; ++t)
+          {
+               scratch[t].pool = NULL;
+               scratch[t].values = NULL;
+               scratch[t].cases = NULL;
+               scratch[t].decay = NULL;
+               scratch[t].cases_used = 0;
+               scratch[t].work = 0;
+               scratch[t].capacity = 0;
+               scratch[t].dimension = 0;
+          }
+          scratch_count = threads;
+     }
+     for (int t = 0; t < scratch_count; ++t)
+     {
+          if (scratch[t].capacity < size)
+          {
+               free(scratch[t].pool);
+               free(scratch[t].values);
+               scratch[t].pool = (int *) malloc(size * sizeof(int));
+               scratch[t].values = (double *) malloc(size * sizeof(double));
+               scratch[t].capacity = (scratch[t].pool == NULL
+                                      || scratch[t].values == NULL) ? 0 : size;
+          }
+          if (scratch[t].dimension < dimension)
+          {
+               free(scratch[t].cases);
+               free(scratch[t].decay);
+               scratch[t].cases = (int *) malloc(dimension * sizeof(int));
+               scratch[t].decay = (long *)
+                    malloc((dimension + 1) * sizeof(long));
+               scratch[t].dimension = (scratch[t].cases == NULL
+                                       || scratch[t].decay == NULL)
+                                      ? 0 : dimension;
+          }
+          if (scratch[t].capacity < size || scratch[t].dimension < dimension)
+          {
+               log_to_file(log_file, __FILE__, __LINE__,
+                           "selector out of memory");
+               return (1);
+          }
+     }
+     return (0);
+}
+
+/* number of the calling thread inside the selection loop */
+int lex_thread_num()
+{
+#ifdef _OPENMP
+     return (omp_get_thread_num());
+#else
+     return (0);
+#endif
+}
+
+/// calculate median of x[0..n), reordering x
+double median(double *x, int n) 
 {
-    // instantiate a vector
-    std::vector<double> x(v.size());
-    x.assign(v.data(),v.data()+v.size());
     // middle element
-    size_t n = x.size()/2;
+    int m = n/2;
     // sort nth element of array
-    std::nth_element(x.begin(),x.begin()+n,x.end());
-    // if evenly sized, return average of middle two elements
-    if (x.size() % 2 == 0) {
-        nth_element(x.begin(),x.begin()+n-1,x.end());
-        return (x[n] + x[n-1]) / 2;
-    }
+    std::nth_element(x, x + m, x + n);
+    // if evenly sized, return average of middle two elements; the lower
+    // one is the largest element left of the middle
+    if (n % 2 == 0)
+        return (x[m] + *std::max_element(x, x + m)) / 2;
     // otherwise return middle element
     else
-        return x[n];
+        return x[m];
 }
 
-/// median absolute deviation
-double mad(const std::vector<double>& x) 
+/// median absolute deviation of x[0..n), overwriting x
+double mad(double *x, int n) 
 {
-    // returns median absolute deviation (MAD)
     // get median of x
-    double x_median = median(x);
+    double x_median = median(x, n);
     //printf("x_median: %e\n",x_median);
-    //calculate absolute deviation from median
-    std::vector<double> dev;
-    for (int i =0; i < x.size(); ++i)
-        dev.push_back(fabs(x[i] - x_median));
-    //printf("deviations: ");
-    for (int i =0; i<dev.size(); ++i)
-        //printf("%e ",dev[i]);
-    //printf("\n");
+    // replace x by its absolute deviation from the median
+    for (int i = 0; i < n; ++i)
+        x[i] = fabs(x[i] - x_median);
     // return median of the absolute deviation
-    return median(dev);
+    return median(x, n);
+}
+/* SplitMix64 finalizer, used both to derive stream keys and as the
+   output function of the counter-based generator. */
+static unsigned long long mix64(unsigned long long x)
+{
+     x += 0x9E3779B97F4A7C15ULL;
+     x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+     x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+     return (x ^ (x >> 31));
+}
+
+/* Start the stream of 'event' in 'generation'. */
+void rng_init(lex_rng *rng, long generation, long event)
+{
+     unsigned long long key = mix64((unsigned long long) lex_seed);
+     key = mix64(key ^ (unsigned long long) generation);
+     rng->key = mix64(key ^ (unsigned long long) event);
+     rng->counter = 0;
+}
+
+/* Draw the next 64 random bits of a stream. */
+unsigned long long rng_next(lex_rng *rng)
+{
+     return (mix64(rng->key + 0x9E3779B97F4A7C15ULL * rng->counter++));
+}
+
+/* Generate a random double in [0,1). */
+double rng_uniform(lex_rng *rng)
+{
+     return ((double) (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0));
 }
+
 /* Generate a random integer. */
-int irand(int range)
+int irand(lex_rng *rng, int range)
 {
      int j;
-     j = (int) ((double)range * (double) rand() / (RAND_MAX+1.0));
+     j = (int) ((double)range * rng_uniform(rng));
      return (j);
 }
 
-double min_obj(const std::vector<int>& p, int o)
+/* The filter kernels keep, in their original order, the slots of
+   pool[0..n) whose value in column 'col' is at most the column minimum
+   over the pool plus 'epsilon', and return how many were kept.
+
+   One pass over the pool keeps every slot within epsilon of the running
+   minimum. The running minimum never falls below the final one, so this is
+   a superset of the survivors; a second pass over the (usually few) kept
+   slots applies the exact threshold. Both passes compact the pool in
+   place. */
+
+static int exact_filter(const double *col, int *pool, int n, double threshold)
 {
-    // returns minimum objective value among individuals p for objective o.
-    double mino = get_objective_value(p[0],o);
-    for (unsigned i = 1; i<p.size(); ++i)
-    {
-        if (get_objective_value(p[i],o) < mino)
-            mino = get_objective_value(p[i],o);
-    }
-    return mino;
+     int kept = 0;
+     for (int k = 0; k < n; ++k)
+     {
+          int s = pool[k];
+          pool[kept] = s;
+          kept += (col[s] <= threshold);
+     }
+     return (kept);
 }
 
-/* Chooses one individual uniformly among those with the lowest counter.
-   Returns ID of chosen individual.
-   Returns -1 of choosing failed for any reason. */
-int lex_choose(int * pop, int starting_pool_size, int *cases, int dimension, double *epsilon) 
+int lex_filter_scalar(const double *col, int *pool, int n, double epsilon)
+{
+     double mino = col[pool[0]];
+     int kept = 0;
+     for (int k = 0; k < n; ++k)
+     {
+          int s = pool[k];
+          double f = col[s];
+          if (f < mino)
+               mino = f;
+          pool[kept] = s;
+          kept += (f <= mino + epsilon);
+     }
+     return (exact_filter(col, pool, kept, mino + epsilon));
+}
+
+/* Filter for dynamic epsilon lexicase: epsilon is the median absolute
+   deviation of column 'col' over the pool itself. One pass gathers the
+   values into 'values' and finds the minimum, the MAD is selected in
+   place in 'values', and a second pass compacts the pool. */
+int lex_filter_dynamic(const double *col, int *pool, int n, double *values)
+{
+     double mino = col[pool[0]];
+     for (int k = 0; k < n; ++k)
+     {
+          double f = col[pool[k]];
+          values[k] = f;
+          if (f < mino)
+               mino = f;
+     }
+     return (exact_filter(col, pool, n, mino + mad(values, n)));
+}
+
+#ifdef LEX_X86_KERNELS
+
+__attribute__((target("avx2")))
+int lex_filter_avx2(const double *col, int *pool, int n, double epsilon)
+{
+     __m256d vmin = _mm256_set1_pd(col[pool[0]]);
+     __m256d veps = _mm256_set1_pd(epsilon);
+     __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+     int lanes[4];
+     double mins[4];
+     int kept = 0;
+     int k = 0;
+     for (; k + 4 <= n; k += 4)
+     {
+          __m128i idx = _mm_loadu_si128((const __m128i *) (pool + k));
+          __m256d f = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), col, idx,
+                                               all, 8);
+          vmin = _mm256_min_pd(vmin, f);
+          int keep = _mm256_movemask_pd(
+               _mm256_cmp_pd(f, _mm256_add_pd(vmin, veps), _CMP_LE_OQ));
+          _mm_storeu_si128((__m128i *) lanes, idx);
+          for (int j = 0; j < 4; ++j)
+          {
+               pool[kept] = lanes[j];
+               kept += (keep >> j) & 1;
+          }
+     }
+     _mm256_storeu_pd(mins, vmin);
+     double mino = std::min(std::min(mins[0], mins[1]),
+                            std::min(mins[2], mins[3]));
+     for (; k < n; ++k)
+     {
+          int s = pool[k];
+          double f = col[s];
+          if (f < mino)
+               mino = f;
+          pool[kept] = s;
+          kept += (f <= mino + epsilon);
+     }
+     return (exact_filter(col, pool, kept, mino + epsilon));
+}
+
+__attribute__((target("avx512f,avx512vl")))
+int lex_filter_avx512(const double *col, int *pool, int n, double epsilon)
+{
+     __m512d vmin = _mm512_set1_pd(col[pool[0]]);
+     __m512d veps = _mm512_set1_pd(epsilon);
+     int kept = 0;
+     int k = 0;
+     for (; k + 8 <= n; k += 8)
+     {
+          __m256i idx = _mm256_loadu_si256((const __m256i *) (pool + k));
+          __m512d f = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF,
+                                               idx, col, 8);
+          vmin = _mm512_mask_min_pd(vmin, 0xFF, vmin, f);
+          __mmask8 keep = _mm512_cmp_pd_mask(f, _mm512_add_pd(vmin, veps),
+                                             _CMP_LE_OQ);
+          _mm256_mask_compressstoreu_epi32(pool + kept, keep, idx);
+          kept += __builtin_popcount(keep);
+     }
+     double mins[8];
+     _mm512_storeu_pd(mins, vmin);
+     double mino = *std::min_element(mins, mins + 8);
+     for (; k < n; ++k)
+     {
+          int s = pool[k];
+          double f = col[s];
+          if (f < mino)
+               mino = f;
+          pool[kept] = s;
+          kept += (f <= mino + epsilon);
+     }
+     return (exact_filter(col, pool, kept, mino + epsilon));
+}
+
+#endif /* LEX_X86_KERNELS */
+
+/* Picks the widest filter kernel the CPU supports. */
+lex_filter_fn choose_filter_kernel()
+{
+#ifdef LEX_X86_KERNELS
+     __builtin_cpu_init();
+     if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+          return (lex_filter_avx512);
+     if (__builtin_cpu_supports("avx2"))
+          return (lex_filter_avx2);
+#endif
+     return (lex_filter_scalar);
+}
+
+/* Filters the full population on case 'c' with obj_order: the survivors
+   are the slots before the first one above the minimum plus 'epsilon'.
+   They are written to 'pool' in slot order, as the scan over the starting
+   pool would leave them, and their number is returned. Few survivors are
+   sorted by slot, many are collected by one pass over the column. */
+int lex_filter_sorted(int c, int *pool, int size, double epsilon)
+{
+     const double *col = obj_matrix + (size_t) c * obj_stride;
+     const int *order = obj_order + (size_t) c * obj_stride;
+     double threshold = col[order[0]] + epsilon;
+     int lo = 1;
+     int hi = size;
+
+     while (lo < hi) /* first rank whose value exceeds 'threshold' */
+     {
+          int mid = lo + (hi - lo) / 2;
+          if (col[order[mid]] <= threshold)
+               lo = mid + 1;
+          else
+               hi = mid;
+     }
+     if (lo * log2(lo + 1.0) < size)
+     {
+          memcpy(pool, order, lo * sizeof(int));
+          std::sort(pool, pool + lo);
+     }
+     else /* sorting the survivors would cost more than a scan */
+     {
+          int kept = 0;
+          for (int s = 0; s < size; ++s)
+          {
+               pool[kept] = s;
+               kept += (col[s] <= threshold);
+          }
+     }
+     return (lo);
+}
+
+/* Prepares an empty prefix cache for a generation with 'dimension'
+   cases. Returns 0 if successful and 1 otherwise. */
+int open_prefix_cache(int dimension)
+{
+     prefix_cache.depth = 0;
+     prefix_cache.child = NULL;
+     if (cache_depth == 0)
+          return (0);
+     prefix_cache.child = (lex_node **) calloc(dimension, sizeof(lex_node *));
+     if (prefix_cache.child == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          return (1);
+     }
+     return (0);
+}
+
+static void free_prefix_node(lex_node *node, int dimension)
+{
+     if (node->child != NULL)
+     {
+          for (int c = 0; c < dimension; ++c)
+               if (node->child[c] != NULL)
+                    free_prefix_node(node->child[c], dimension);
+          free(node->child);
+     }
+     free(node->pool);
+     free(node);
+}
+
+/* Frees all nodes cached during the generation. */
+void close_prefix_cache()
+{
+     if (prefix_cache.child == NULL)
+          return;
+     for (int c = 0; c < dimension; ++c)
+          if (prefix_cache.child[c] != NULL)
+               free_prefix_node(prefix_cache.child[c], dimension);
+     free(prefix_cache.child);
+     prefix_cache.child = NULL;
+}
+
+/* Caches 'pool' as the child of 'parent' reached by case 'c' and returns
+   the cached node. If another thread cached that prefix first, its node
+   is returned instead; both hold the same pool since filtering is
+   deterministic. Returns NULL if the node could not be allocated. */
+lex_node *cache_prefix(lex_node *parent, int c, const int *pool,
+                       int pool_size)
+{
+     lex_node *node = (lex_node *) malloc(sizeof(lex_node));
+     if (node == NULL)
+          return (NULL);
+     node->pool = (int *) malloc(pool_size * sizeof(int));
+     node->size = pool_size;
+     node->depth = parent->depth + 1;
+     node->child = NULL;
+     if (node->depth < cache_depth && pool_size > 1)
+          node->child = (lex_node **) calloc(dimension, sizeof(lex_node *));
+     if (node->pool == NULL
+         || (node->depth < cache_depth && pool_size > 1 && node->child == NULL))
+     {
+          free(node->child);
+          free(node->pool);
+          free(node);
+          return (NULL);
+     }
+     memcpy(node->pool, pool, pool_size * sizeof(int));
+
+     lex_node *expected = NULL;
+     if (!__atomic_compare_exchange_n(&parent->child[c], &expected, node,
+                                      false, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE))
+     {
+          free(node->child);
+          free(node->pool);
+          free(node);
+          return (expected);
+     }
+     return (node);
+}
+
+/* Returns the lexicographic minimum of the slots pool[0..n) under the
+   case order cases[0..ncases), ties broken by reservoir sampling in
+   proportion to slot_weight (uniformly without deduplication). One pass
+   over the pool; a comparison stops at the first case in which the two
+   slots differ. If 'tied' is not NULL, the number of slots sharing the
+   minimum is stored there. */
+int lex_min_pass(const int *pool, int n, const int *cases, int ncases,
+                 lex_rng *rng, int *tied)
+{
+     const double *first = obj_matrix + (size_t) cases[0] * obj_stride;
+     int best = pool[0];
+     double best_first = first[best];
+     int ties = (slot_weight != NULL) ? slot_weight[best] : 1;
+     int tied_slots = 1;
+     for (int k = 1; k < n; ++k)
+     {
+          int s = pool[k];
+          double f = first[s];
+          if (f > best_first) /* the common case: decided by the first case */
+               continue;
+          int c = 1;
+          const double *col = first;
+          if (f == best_first)
+          {
+               for (; c < ncases; ++c)
+               {
+                    col = obj_matrix + (size_t) cases[c] * obj_stride;
+                    if (col[s] != col[best])
+                         break;
+               }
+               if (c == ncases)
+               {
+                    int w = (slot_weight != NULL) ? slot_weight[s] : 1;
+                    ties += w;
+                    ++tied_slots;
+                    if (irand(rng, ties) < w)
+                         best = s;
+                    continue;
+               }
+               if (col[s] > col[best])
+                    continue;
+          }
+          best = s;
+          best_first = f;
+          ties = (slot_weight != NULL) ? slot_weight[s] : 1;
+          tied_slots = 1;
+     }
+     if (tied != NULL)
+          *tied = tied_slots;
+     return (best);
+}
+
+/* Filters the slots in own->pool on the cases in own->cases, compacting
+   the buffer in place, and chooses one of the survivors in proportion to
+   slot_weight (uniformly without deduplication). Filtering resumes from
+   the deepest prefix of 'cases' found in the prefix cache, and the pools
+   of new prefixes are added to it. The starting pool is read from
+   'start_pool'; in FIRST_FILTER_SORTED mode it must hold all slots of
+   obj_matrix. With dynamic epsilon, 'epsilon' holds the MAD over the
+   population, used for the first case unless the events start from
+   subsamples, and the other cases compute theirs in 'values'. Filtering
+   stops early once the next case would take the work spent on the event
+   beyond 'event_budget'; cached cases count as if filtered. The cases and
+   comparisons spent are added to own->cases_used and own->work, the pool
+   sizes to own->decay if a stats_file is set. With epsilon 0, once no
+   more prefixes are to be cached and at most 'fast_lexmin' slots are
+   left, the remaining cases are handled by lex_min_pass() on the pool at
+   hand; its tied slots count as the pool after each of those cases.
+   Returns the slot of the chosen individual in obj_matrix. */
+int lex_choose(lex_scratch *own, const int *start_pool,
+               int starting_pool_size, int dimension, double *epsilon,
+               lex_rng *rng) 
 {  
-     std::vector<int> pool;
-     for (int i =0;i<starting_pool_size; ++i)
-         pool.push_back(pop[i]);
-     //printf("%i: initial pool: \t",__LINE__);
-     //for (int i = 0; i<starting_pool_size; ++i)
-     //    printf("%i,",pool[i]);
-     //printf("\n");
-     //printf("%i: cases: \t",__LINE__);
-     //for (int i = 0; i<dimension; ++i)
-     //    printf("%i,",cases[i]);
-     //printf("\n");  
-     
-     bool pass = true;
-     int c = 0; 
-     int pool_size = 0;
-     double p = 10000; //precision
-     while (pass) 
-     { 
-         
-         std::vector<int> sel_pool;
-
-         //printf("pool: ");
-         //for (unsigned i =0; i<pool.size();++i) 
-         //    printf("%i(%e) ",pool[i],get_objective_value(pool[i],cases[c]));
-         //printf("\n");
-         double threshold = min_obj(pool,cases[c]) + epsilon[cases[c]];
-         //printf("case %i threshold: %e + %e = %e\n",cases[c],min_obj(pool,cases[c]),epsilon[cases[c]],threshold);
-         //printf("sel_pool: ");
-         for (int i = 0; i < pool.size(); ++i)
-         {
-             double f = get_objective_value(pool[i],cases[c]);
-                          
-             if (f <= threshold)
-             {
-                 // add pool[i] to winners
-                 //printf("%i (%e), ",pool[i],f);
-                 sel_pool.push_back(pool[i]);
-             }
-         }
-         //printf("\n");
-         //printf("%i: size of sel_pool:%i\n",__LINE__,sizeof(sel_pool)/sizeof(sel_pool[0]));
-         //printf("%i: pool_size: %i\n",__LINE__,pool_size);
-         ++c;   // increment case            
-         pass = (sel_pool.size() > 1 && c < dimension); // keep going if needed
-         assert(sel_pool.size()>0); 
-         pool = sel_pool;
-     }
-     //printf("final pool size: %i\n",pool.size());
-     int pick = irand(pool.size());
-     int selection = pool[pick];
-     //printf("selecting %i (pick = %i)\n",selection, pick);  
-     return selection;
-
-     /// FEMO ///////////
-    // int *ids_to_choose;
-    // int size, min, current_id, pick_id, return_id;
-    // 
-    // ids_to_choose = (int *) malloc(get_size() * sizeof(int));
-    // if (ids_to_choose == NULL)
-    // {
-    //      log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
-    //      return (-1);
-    // }  
-    // 
-    // current_id = get_first();
-    // if(current_id == -1)
-    //      return(-1);
-    // 
-    // min = get_counter(current_id);
-    // size = 1;
-    // ids_to_choose[0] = current_id;
-    // current_id = get_next(current_id);
-    // while(current_id != -1)
-    // {
-    //      if(min > get_counter(current_id))
-    //      {
-    //           size = 1;
-    //           ids_to_choose[0] = current_id;
-    //           min = get_counter(current_id);
-    //      }
-    //      else if(min == get_counter(current_id))
-    //      {
-    //           size++;
-    //           ids_to_choose[size - 1] = current_id;
-    //      }
-    //      current_id = get_next(current_id);
-    // }
-    // 
-    // pick_id = irand(size);
-    // 
-    // return_id = ids_to_choose[pick_id];
-
-    // free(ids_to_choose);
-    // 
-    // return (return_id);
+     int *pool = own->pool;
+     int *cases = own->cases;
+     int pool_size = starting_pool_size;
+     int c = 0;
+     lex_node *node = (prefix_cache.child != NULL) ? &prefix_cache : NULL;
+     const int *from = start_pool; /* survivors of cases[0..c) */
+     long spent = 0; /* individual-case comparisons of this event */
+     long *decay = (stats_file[0] != '\0') ? own->decay : NULL;
+
+     if (decay != NULL)
+          decay[0] += starting_pool_size;
+
+     /* walk down the cached prefixes of this case order */
+     while (node != NULL && node->child != NULL && c < dimension)
+     {
+          lex_node *next = __atomic_load_n(&node->child[cases[c]],
+                                           __ATOMIC_ACQUIRE);
+          if (next == NULL)
+               break;
+          spent += (c == 0) ? starting_pool_size : node->size;
+          if (event_budget > 0 && c > 0 && spent > event_budget)
+               break;
+          node = next;
+          ++c;
+          if (decay != NULL)
+               decay[c] += node->size;
+     }
+     if (c > 0)
+     {
+          pool_size = node->size;
+          from = node->pool;
+     }
+
+     while ((c == 0 || pool_size > 1) && c < dimension) // keep going if needed
+     {
+          if (event_budget > 0 && c > 0 && spent + pool_size > event_budget)
+               break; // out of budget, choose among the survivors so far
+          /* no more prefixes to cache: stream for the minimum */
+          if (!eplex && pool_size <= fast_lexmin && event_budget == 0
+              && (node == NULL || node->child == NULL)
+              && !(c == 0 && use_sorted_first))
+          {
+               int tied;
+               int slot = lex_min_pass(from, pool_size, cases + c,
+                                       dimension - c, rng, &tied);
+               own->cases_used += dimension;
+               own->work += spent + pool_size;
+               own->max_cases = std::max(own->max_cases, (long) dimension);
+               own->final_pool += tied;
+               if (decay != NULL)
+                    for (int k = c + 1; k <= dimension; ++k)
+                         decay[k] += tied;
+               return (slot);
+          }
+          spent += pool_size;
+
+          const double *col = obj_matrix + (size_t) cases[c] * obj_stride;
+          if (c == 0 && use_sorted_first)
+               pool_size = lex_filter_sorted(cases[c], pool, pool_size,
+                                             epsilon[cases[c]]);
+          else
+          {
+               if (from != pool)
+                    memcpy(pool, from, pool_size * sizeof(int));
+               if (dynamic_epsilon && (c > 0 || use_pool_sample))
+                    pool_size = lex_filter_dynamic(col, pool, pool_size,
+                                                   own->values);
+               else
+                    pool_size = lex_filter(col, pool, pool_size,
+                                           epsilon[cases[c]]);
+          }
+          from = pool;
+          assert(pool_size > 0);
+          if (node != NULL && node->child != NULL)
+               node = cache_prefix(node, cases[c], pool, pool_size);
+          ++c;   // increment case
+          if (decay != NULL)
+               decay[c] += pool_size;
+     }
+     own->cases_used += c;
+     own->work += spent;
+     own->max_cases = std::max(own->max_cases, (long) c);
+     own->final_pool += pool_size;
+     if (decay != NULL)
+          for (int k = c + 1; k <= dimension; ++k)
+               decay[k] += pool_size;
+     if (slot_weight != NULL) // pick in proportion to the multiplicities
+     {
+          int total = 0;
+          for (int k = 0; k < pool_size; ++k)
+               total += slot_weight[from[k]];
+          int r = irand(rng, total);
+          int k = 0;
+          while (r >= slot_weight[from[k]])
+               r -= slot_weight[from[k++]];
+          return from[k];
+     }
+     int pick = irand(rng, pool_size);
+     return from[pick];
+}
+
+
+/* Appends one line of statistics on the generation just selected to
+   'stats_file', truncating the file in the first generation:
+
+   generation G size N slots S prepare_ms P epsilon_ms E select_ms L
+   cases_mean C cases_max M final_pool_mean F distinct_parents D
+   pool_decay p_0 ... p_ncases
+
+   with N individuals handed to select_ind(), S slots each selection
+   event starts from (after nd_filter, dedup or downsample_pool), the
+   times spent on the objective matrix (including nd_filter, dedup and
+   sorting), on calculate_epsilon() and in the selection loop, the mean
+   and largest number of cases applied by an event, the mean number of
+   slots left at the tie-break, the number of distinct parents among
+   'parents' and the mean pool size after k cases, k = 0..ncases.
+   Errors are logged. Returns 0 if successful and 1 otherwise. */
+int write_stats(long generation, int size, int slots, int ncases,
+                const int *parents)
+{
+     FILE *fp;
+     int *sorted = (int *) malloc(std::max(mu, 1) * sizeof(int));
+     if (sorted == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__, "selector out of memory");
+          return (1);
+     }
+     memcpy(sorted, parents, mu * sizeof(int));
+     std::sort(sorted, sorted + mu);
+     last_stats.distinct = (mu > 0) ? 1 : 0;
+     for (int i = 1; i < mu; ++i)
+          if (sorted[i] != sorted[i - 1])
+               ++last_stats.distinct;
+     free(sorted);
+
+     fp = fopen(stats_file, (generation == 0) ? "w" : "a");
+     if (fp == NULL)
+     {
+          log_to_file(log_file, __FILE__, __LINE__,
+                      "couldn't open stats_file");
+          return (1);
+     }
+     double events = std::max(mu, 1);
+     fprintf(fp, "generation %ld size %d slots %d", generation, size, slots);
+     fprintf(fp, " prepare_ms %.4f epsilon_ms %.4f select_ms %.4f",
+             1e3 * last_stats.prepare_time, 1e3 * last_stats.epsilon_time,
+             1e3 * last_stats.select_time);
+     fprintf(fp, " cases_mean %.4f cases_max %ld final_pool_mean %.4f",
+             last_stats.cases / events, last_stats.max_cases,
+             last_stats.final_pool / events);
+     fprintf(fp, " distinct_parents %d pool_decay", last_stats.distinct);
+     for (int k = 0; k <= ncases; ++k)
+     {
+          long total = 0;
+          for (int t = 0; t < scratch_count; ++t)
+               total += scratch[t].decay[k];
+          fprintf(fp, " %.4g", total / events);
+     }
+     fprintf(fp, "\n");
+     fclose(fp);
+     return (0);
 }
 
 
@@ -677,14 +1992,14 @@ double get_objective_value(int id, int index)
      return(temp->objective_value[index]);  
 }
 // shuffle contents of int array.
-void shuffle(int *array, size_t n)
+void shuffle(lex_rng *rng, int *array, size_t n)
 {
     if (n > 1) 
     {
         size_t i;
         for (i = 0; i < n - 1; i++) 
         {
-          size_t j = i + rand() / (RAND_MAX / (n - i) + 1);
+          size_t j = i + irand(rng, n - i);
           int t = array[j];
           array[j] = array[i];
           array[i] = t;
@@ -38,15 +38,104 @@
 /* maximal length of entries in local cfg file */
 #define CFG_NAME_LENGTH 128   /* change the value if you like */
 
+/* columns of the objective matrix start on OBJ_MATRIX_ALIGN byte
+   boundaries and hold a multiple of OBJ_MATRIX_PAD slots */
+#define OBJ_MATRIX_ALIGN 64
+#define OBJ_MATRIX_PAD 8
+
+/* values of the 'first_filter' parameter */
+#define FIRST_FILTER_SCAN 0   /* filter the starting pool on the first case */
+#define FIRST_FILTER_SORTED 1 /* binary search in per-objective sort orders */
+
 #include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEX_X86_KERNELS /* build the AVX2/AVX-512 filter kernels */
+#endif
+
 /*---| declaration of global variables (defined in selector_user.c) |-----*/
 
 extern char *log_file; /* file to log to */
 
 extern char paramfile[]; /* file with local parameters */
 
+/* local parameters, set by read_local_parameters() */
+extern bool eplex;
+extern bool dynamic_epsilon;
+extern int lex_seed;
+extern int cache_depth;
+extern int first_filter;
+extern int fast_lexmin;
+extern bool nd_filter;
+extern int epsilon_sample;
+extern bool dedup;
+extern int downsample_cases;
+extern int downsample_pool;
+extern long work_budget;
+extern int window;
+extern char stats_file[];
+
 /*-----------------------------------------------------------------------*/
 
+/* counter-based random stream. Every selection event gets its own
+   stream keyed by the seed, the generation and the event number, so
+   parallel selection is reproducible for any number of threads. */
+typedef struct lex_rng_t
+{
+     unsigned long long key;     /* stream key */
+     unsigned long long counter; /* number of draws from this stream */
+} lex_rng;
+
+/* buffers owned by one thread of the selection loop and reused by all
+   of its selection events */
+typedef struct lex_scratch_t
+{
+     int *pool;      /* candidate slots, filtered in place */
+     double *values; /* objective values, for computing epsilon */
+     int *cases;     /* case order of the current selection event */
+     int capacity;   /* number of slots 'pool' and 'values' can hold */
+     int dimension;  /* number of cases 'cases' can hold */
+     long cases_used; /* cases applied by this thread's selection events
+                         in the current generation */
+     long work;      /* individual-case comparisons spent on them */
+     long max_cases; /* most cases applied by one of these events */
+     long final_pool; /* slots left at their tie-breaks, summed */
+     long *decay;    /* with a stats_file: decay[k] sums the pool sizes
+                        after k cases, k = 0..dimension */
+} lex_scratch;
+
+/* what one call to select_ind() did */
+typedef struct lex_stats_t
+{
+     long events; /* selection events */
+     long cases;  /* cases applied, summed over the events */
+     long work;   /* individual-case comparisons, summed over the events */
+     long max_cases;  /* most cases applied by one event */
+     long final_pool; /* slots left at the tie-breaks, summed */
+     int distinct;    /* distinct parents (only with a stats_file) */
+     double prepare_time; /* seconds spent on the objective matrix */
+     double epsilon_time; /* seconds spent in calculate_epsilon() */
+     double select_time;  /* seconds spent in the selection loop */
+} lex_stats;
+
+extern lex_stats last_stats; /* set by select_ind() */
+
+/* node of the case-prefix cache, holding the pool that survives the
+   cases on its path from the root */
+typedef struct lex_node_t
+{
+     int *pool;                 /* surviving slots, in filter order */
+     int size;                  /* number of surviving slots */
+     int depth;                 /* number of cases on the path */
+     struct lex_node_t **child; /* cached children, one entry per case;
+                                   NULL at the maximal depth */
+} lex_node;
+
+/* min-and-filter kernel: keeps the slots of pool[0..n) within 'epsilon'
+   of the minimum of column 'col' and returns their number */
+typedef int (*lex_filter_fn)(const double *col, int *pool, int n,
+                             double epsilon);
+
 struct individual_t
 {
      /**********| added for LEX |**************/
@@ -55,6 +144,31 @@ struct individual_t
      /**********| addition for LEX end |*******/
 };
 
+/* storage for the individuals of one generation, see begin_generation() */
+typedef struct lex_slab_t
+{
+     individual *inds; /* individuals, handed out in order */
+     double *values;   /* their objective vectors, 'dimension' apart */
+     int capacity;     /* number of individuals the slab holds */
+     int dimension;    /* number of objectives per vector */
+     int used;         /* individuals handed out since the last reset */
+     int live;         /* of those, individuals not yet freed */
+} lex_slab;
+
+/* what LEX keeps from one generation to the next for one run; the
+   selector serving several runs (see selector.c) keeps one of these per
+   run. The parameters are the same for all runs and the scratch space
+   is rebuilt by every select_ind(), so neither is part of it. */
+typedef struct lex_run_t
+{
+     long generation;   /* lex_generation */
+     lex_slab slabs[2]; /* slabs holding the individuals of the run */
+     int current_slab;  /* slab individuals are taken from */
+     int *window_ids;   /* steady state window, see slide_window() */
+     int window_count;
+     int window_capacity;
+} lex_run;
+
 /*-------------------| functions for individual struct |----------------*/
 
 int set_objective_value(individual *ind, int i, double obj_value);
@@ -197,6 +311,24 @@ int is_finished();
 /* read local parameters from file */
 int read_local_parameters();
 
+/* switch the individuals of the global population that are created next
+   to an emptied slab; returns 0 if successful and 1 otherwise */
+int begin_generation(int count);
+
+/* free both slabs */
+void free_slabs();
+
+/* steady state: add the 'count' individuals 'ids' to the window and
+   remove the oldest individuals beyond 'window' from the global
+   population; returns 0 if successful and 1 otherwise */
+int slide_window(int count, int *ids);
+
+/* copy the state of the current run to 'run' */
+void save_lex_run(lex_run *run);
+
+/* make 'run', saved by save_lex_run(), the current run */
+void load_lex_run(lex_run *run);
+
 /* select mu individuals out of new_identity (of size size)
    and return their ids */ 
 int select_ind(int size, int *new_identity, int *sel_identities,
@@ -208,17 +340,77 @@ int select_ind(int size, int *new_identity, int *sel_identities,
 //
 ///* Determines if two individuals are equal in all objective values.*/
 //int is_equal(int ind_a, int ind_b, int dim);
+// start the random stream of selection event 'event' in 'generation'
+void rng_init(lex_rng *rng, long generation, long event);
+// next 64 random bits of a stream
+unsigned long long rng_next(lex_rng *rng);
+// random double in [0,1)
+double rng_uniform(lex_rng *rng);
 // return random integer
-int irand(int range);
+int irand(lex_rng *rng, int range);
 // shuffle int array
-void shuffle(int* array, size_t n);
+void shuffle(lex_rng *rng, int* array, size_t n);
 int compare (const void * a, const void * b);
-double median(const std::vector<double>& v); 
-double mad(const std::vector<double>& x);
-void calculate_epsilon(int *ids, int size, int dimension, double *epsilon);
-
-///* choose individual via lexicase selection */
-int lex_choose(int * pop, int starting_pool_size, int *case_order, int dimension, double *epsilon);
+// median and median absolute deviation, reordering the array
+double median(double *x, int n); 
+double mad(double *x, int n);
+void calculate_epsilon(int size, int dimension, double *epsilon,
+                       long generation);
+
+/* copy the objective values of 'ids' into the dense objective matrix,
+   slot s holding ids[s]; returns 0 if successful and 1 otherwise */
+int build_objective_matrix(int size, int *ids, int dimension);
+
+/* drop the slots of the objective matrix that are dominated by more than
+   epsilon; returns the number of slots left or -1 on error */
+int filter_dominated(int size, int dimension, const double *epsilon);
+
+/* collapse identical objective vectors into weighted slots; returns the
+   number of distinct slots or -1 on error */
+int dedup_objective_matrix(int size, int dimension);
+
+/* sort the slots of the objective matrix by each objective */
+int build_objective_order(int size, int dimension);
+
+/* free the buffers select_ind() keeps across generations */
+void free_selection_buffers();
+
+/* make sure every thread has scratch buffers for 'size' slots */
+int prepare_scratch(int size, int dimension);
+int lex_thread_num();
+
+/* min-and-filter kernels and the choice among them */
+int lex_filter_scalar(const double *col, int *pool, int n, double epsilon);
+#ifdef LEX_X86_KERNELS
+int lex_filter_avx2(const double *col, int *pool, int n, double epsilon);
+int lex_filter_avx512(const double *col, int *pool, int n, double epsilon);
+#endif
+lex_filter_fn choose_filter_kernel();
+int lex_filter_dynamic(const double *col, int *pool, int n, double *values);
+int lex_filter_sorted(int c, int *pool, int size, double epsilon);
+
+/* case-prefix cache shared by the selection events of a generation */
+int open_prefix_cache(int dimension);
+void close_prefix_cache();
+lex_node *cache_prefix(lex_node *parent, int c, const int *pool,
+                       int pool_size);
+
+/* lexicographic minimum of a pool, ties broken at random; the number of
+   tied slots is stored in '*tied' unless it is NULL */
+int lex_min_pass(const int *pool, int n, const int *cases, int ncases,
+                 lex_rng *rng, int *tied);
+
+/* choose individual via lexicase selection on the case order in
+   own->cases, filtering own->pool in place; returns the matrix slot of
+   the chosen individual */
+int lex_choose(lex_scratch *own, const int *start_pool,
+               int starting_pool_size, int dimension, double *epsilon,
+               lex_rng *rng);
+
+/* append the record of the last generation to 'stats_file'; returns 0 if
+   successful and 1 otherwise */
+int write_stats(long generation, int size, int slots, int ncases,
+                const int *parents);
 
 int get_counter(int id);
 
@@ -228,8 +420,6 @@ int decrease_counter(int id);
 
 double get_objective_value(int id, int index);
 
-double min_obj(const std::vector<int>& p, int o);
-
 /**********| addition for LEX end |*******/
 
 
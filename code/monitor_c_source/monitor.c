@@ -112,6 +112,8 @@ int main(int argc, char *argv[])
 	 /* read and check common parameters (they should be equal)*/
      read_common_parameters(cfg_file_variator);
      read_common_parameters(cfg_file_selector);
+     if (open_transport() != 0)
+          return (1);
 
 	 /* read monitor parameters */
      read_local_parameters();
@@ -175,6 +177,8 @@ int main(int argc, char *argv[])
 		 wait(poll);
 	 }
 
+	 close_transport();
+
 	 if (LOG) printf("kill myself\n");
      return (0);
 }
@@ -282,53 +286,180 @@ void copyVariate()
 
 /*-------------------------| io |---------------------------------------*/
 
-int* move_arc()
-/* Moves arc file from selector to variator side.
-   Returns dynamic array with ids. Size is stored in the first entry. */
+static int* read_ids(char *filename)
+/* Reads the sel or arc file 'filename', in either format, and deletes
+   its content. Returns dynamic array with ids. Size is stored in the
+   first entry. */
 {
-     int size, result;
-     FILE *fp, *fp2; 
-     char tag[4];
-     int i;
-     int *keep = NULL;
-     /* keep[0] = size of archive
-	    keep[i] = ids of archive elements (1 <= i <= size) */
+     int result;
+     int *ids = NULL;
+     binary_data data;
+
+     result = read_data(filename, 0, &data);
+     assert(result == 0); /* file completely written */
+     ids = (int *) malloc(sizeof(int)*(data.count + 1));
+     assert(ids != NULL);
+     ids[0] = data.count; /* Store size of array in first entry */
+     memcpy(ids + 1, data.ids, sizeof(int) * data.count);
+     free(data.buffer);
+
+     empty_file(filename);
+     return (ids);
+}
+
 
+static void write_ids(char *filename, int *ids)
+/* Writes the ids in 'ids' (size in the first entry) to the sel or arc
+   file 'filename' in the format given in the cfg files. */
+{
+     FILE *fp;
+     int i, result;
+     binary_data data;
 
-     fp = fopen(arc_file_selector, "r");
-     fp2 = fopen(arc_file_variator, "w");
+     if (format == FORMAT_BINARY)
+     {
+	 result = new_binary(&data, ids[0], 0);
+	 assert(result == 0);
+	 memcpy(data.ids, ids + 1, sizeof(int) * ids[0]);
+	 result = write_binary(filename, &data);
+	 assert(result == 0);
+	 return;
+     }
+
+     fp = begin_file(filename);
      assert(fp != NULL);
-     assert(fp2 != NULL);
+     fprintf(fp, "%d\n", ids[0]);
+     for (i = 1; i <= ids[0]; i++)
+	 fprintf(fp, "%d\n", ids[i]);
+     fprintf(fp, "END");
+     result = publish_file(fp, filename);
+     assert(result == 0);
+}
+
+
+static double** read_records(char *filename, int count)
+/* Reads the 'count' individuals of the ini or var file 'filename', in
+   either format, and deletes its content. Returns f with
+   f[i][0] = Index of element (0 <= i < count)
+   f[i][j] = jth objective of element (0 <= i < count) */
+{
+     int i, j, result;
+     double **f = NULL;
+     binary_data data;
+
+     f = (double **) malloc(count * sizeof(double*));
+     assert (f != NULL);
      
-     /* read arc file and store indexes in keep array */
-     fscanf(fp, "%d", &size);
-     assert(size > 0); /* we need to keep at least one individual */
-     fprintf(fp2, "%d\n", size);
+     result = read_data(filename, dimension, &data);
+     assert(result == 0); /* file completely written */
+     assert(data.count == count);
+     for (i = 0; i < count; i++)
+     {
+	 f[i] = (double *) malloc((dimension + 1) * sizeof(double));
+	 f[i][0] = data.ids[i];
+	 for (j = 1; j < dimension + 1; j++)
+	     f[i][j] = data.values[i * dimension + j - 1];
+     }
+     free(data.buffer);
+
+     empty_file(filename);
+     return (f);  
+}
 
-     result = 0;
-     keep = (int *) malloc(sizeof(int)*(size + 1));
-     assert(keep != NULL);
-     keep[0] = size; /* Store size of array in first entry */
 
-     for (i = 1; i <= size; i++)
+static void write_records(char *filename, double **f, int count)
+/* Writes the 'count' individuals in 'f' (as returned by read_records())
+   to the ini or var file 'filename' in the format given in the cfg
+   files. */
+{
+     int i, j, result;
+     FILE *fp;
+     binary_data data;
+
+     if (format == FORMAT_BINARY)
      {
-          result = fscanf(fp, "%d", &keep[i]);
-	  assert(result != EOF); /* fscanf() returns EOF if reading failed */
-	  fprintf(fp2, "%d\n", keep[i]);
+	 result = new_binary(&data, count, dimension);
+	 assert(result == 0);
+	 for (i = 0; i < count; i++)
+	 {
+	     data.ids[i] = (int) f[i][0];
+	     for (j = 1; j < dimension + 1; j++)
+		 data.values[i * dimension + j - 1] = f[i][j];
+	 }
+	 result = write_binary(filename, &data);
+	 assert(result == 0);
+	 return;
      }
 
-     fscanf(fp, "%s", tag);
-     assert(strcmp(tag, "END") == 0); /* "END" here ? */
-     fprintf(fp2, "END");
-     fclose(fp);
-     fclose(fp2);
-     
-     /* deleting content */
-     fp = fopen(arc_file_selector, "w");
+     fp = begin_file(filename);
      assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
+     fprintf(fp, "%d\n", (count * (dimension + 1)));
      
+     for(i = 0; i < count; i++)
+     {
+	 fprintf(fp, "%d ", (int) f[i][0]); /* prints also a space */
+	 for (j = 1; j < dimension + 1; j++)
+	     fprintf(fp, "%E ", f[i][j]); /* prints also a space */
+	 fprintf(fp, "\n");
+     }
+     
+     fprintf(fp, "END");
+     result = publish_file(fp, filename);
+     assert(result == 0);
+}
+
+
+static void copy_shm_records(char *from, char *to, int count, double **f)
+/* Copies the 'count' records of the area for the file 'from' to the
+   area for the file 'to' and into 'f' as read_records() does, and
+   empties the area of 'from'. */
+{
+     int *ids = shm_ids(from);
+     double *values = shm_values(from);
+     int i, j;
+
+     assert(get_shm_word(from) == count);
+     memcpy(shm_ids(to), ids, sizeof(int) * count);
+     memcpy(shm_values(to), values, sizeof(double) * count * dimension);
+     for (i = 0; i < count; i++)
+     {
+	 f[i] = (double *) malloc((dimension + 1) * sizeof(double));
+	 f[i][0] = ids[i];
+	 for (j = 1; j < dimension + 1; j++)
+	     f[i][j] = values[i * dimension + j - 1];
+     }
+     set_shm_word(to, count);
+     set_shm_word(from, 0);
+}
+
+
+int* move_arc()
+/* Moves arc file from selector to variator side.
+   Returns dynamic array with ids. Size is stored in the first entry. */
+{
+     int size;
+     int *keep = NULL;
+     /* keep[0] = size of archive
+	    keep[i] = ids of archive elements (1 <= i <= size) */
+
+
+     if (transport != TRANSPORT_FILE)
+     {
+	 size = get_shm_word(arc_file_selector);
+	 assert(size > 0); /* we need to keep at least one individual */
+	 keep = (int *) malloc(sizeof(int)*(size + 1));
+	 assert(keep != NULL);
+	 keep[0] = size; /* Store size of array in first entry */
+	 memcpy(keep + 1, shm_ids(arc_file_selector), sizeof(int) * size);
+	 memcpy(shm_ids(arc_file_variator), keep + 1, sizeof(int) * size);
+	 set_shm_word(arc_file_variator, size);
+	 set_shm_word(arc_file_selector, 0);
+	 return (keep);
+     }
+
+     keep = read_ids(arc_file_selector);
+     assert(keep[0] > 0); /* we need to keep at least one individual */
+     write_ids(arc_file_variator, keep);
      return (keep);
 }
 
@@ -336,160 +467,59 @@ int* move_arc()
 void move_sel()
 /* Moves sel file from selector to variator side.*/
 {
-     int size, result; 
-     FILE *fp, *fp2; 
-     char tag[4];
-     int i;
-     int id;
-     
-     fp = fopen(sel_file_selector, "r");
-     fp2 = fopen(sel_file_variator, "w");
-     assert(fp != NULL);
-     assert(fp2 != NULL);
-     
-     /* read sel file and store indexes in 'id_array' */
-     fscanf(fp, "%d", &size);
-     fprintf(fp2, "%d\n", size);
+     int size;
+     int *id = NULL;
 
-     for(i = 0; i < size; i++)
+     if (transport != TRANSPORT_FILE)
      {
-          result = fscanf(fp, "%d", &id);
-          assert(result != EOF); /* fscanf() returns EOF if reading failed */
-	  fprintf(fp2, "%d\n", id);
+	 size = get_shm_word(sel_file_selector);
+	 memcpy(shm_ids(sel_file_variator), shm_ids(sel_file_selector),
+		sizeof(int) * size);
+	 set_shm_word(sel_file_variator, size);
+	 set_shm_word(sel_file_selector, 0);
+	 return;
      }
-     
-     fscanf(fp, "%s", tag);
-     assert(strcmp(tag, "END") == 0); /* "END" not found */
-     fprintf(fp2, "END");
-     fclose(fp);
-     fclose(fp2);
-     
-     /* deleting content */
-     fp = fopen(sel_file_selector, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);     
+
+     id = read_ids(sel_file_selector);
+     write_ids(sel_file_variator, id);
+     free(id);
 }
 
 
 double** move_ini()
-/*  */
+/* Moves ini file from variator to selector side. Returns the
+   individuals as read_records() does. */
 {
-     int i, j, size;
-     char tag[4];
-     FILE *fp, *fp2;
-     int result; /* stores return value of called functions */
-     int identity;
      double **f = NULL;
-	 /* f[i][0] = Index of element (0 <= i < alpha)
-	    f[i][j] = jth objective of element (0 <= i < alpha) */
-
-     f = (double **) malloc(alpha * sizeof(double*));
-     assert (f != NULL);
-     
-     fp = fopen(ini_file_variator, "r");
-     fp2 = fopen(ini_file_selector, "w");
-     assert(fp != NULL);
-     assert(fp2 != NULL);
 
-     fscanf(fp, "%d", &size);
-     /* test if size has a valid value */
-     assert (size == ((dimension + 1) * alpha));
-     fprintf(fp2, "%d\n", (alpha * (dimension + 1)));
-     
-     for(i = 0; i < alpha; i++)
+     if (transport != TRANSPORT_FILE)
      {
-	 f[i] = (double *) malloc((dimension + 1 ) * sizeof(double));
-
-	 result = fscanf(fp, "%d", &identity); /* fscanf() returns EOF
-                                                   if reading fails.*/
-	 assert(result != EOF); /* file not completely written */
-	 f[i][0] = identity;
-	 fprintf(fp2, "%d ", identity); /* prints also a space */
-
-	 for (j = 1; j < dimension + 1; j++)
-	 {
-	     result = fscanf(fp, "%le", &f[i][j]);
-	     assert(result != EOF); /* file not completely written */
-	     fprintf(fp2, "%E ", f[i][j]); /* prints also a space */
-	 }
-	 
-	 fprintf(fp2, "\n");
+	 f = (double **) malloc(alpha * sizeof(double*));
+	 assert (f != NULL);
+	 copy_shm_records(ini_file_variator, ini_file_selector, alpha, f);
+	 return (f);
      }
-     
-     fscanf(fp, "%s", tag);
-     assert(strcmp(tag, "END") == 0);
-     fprintf(fp2, "END");
-     
-     fclose(fp);
-     fclose(fp2);
-     
-     /* deleting content */
-     fp = fopen(ini_file_variator, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
-     
+
+     f = read_records(ini_file_variator, alpha);
+     write_records(ini_file_selector, f, alpha);
      return (f);  
 }
 
 double** move_var()
-/*  */
+/* Moves var file from variator to selector side. Returns the
+   individuals as read_records() does. */
 {
-     int i, j, size;
-     char tag[4];
-     FILE *fp, *fp2;
-     int result; /* stores return value of called functions */
-     int identity;
      double **f = NULL;
-	 /* f[i][0] = Index of element (0 <= i < alpha)
-	    f[i][j] = jth objective of element (0 <= i < alpha) */
-
-     f = (double **) malloc(lambda * sizeof(double*));
-     assert (f != NULL);
-     
-     fp = fopen(var_file_variator, "r");
-     fp2 = fopen(var_file_selector, "w");
-     assert(fp != NULL);
-     assert(fp2 != NULL);
 
-     fscanf(fp, "%d", &size);
-     /* test if size has a valid value */
-     assert (size == ((dimension + 1) * lambda));
-     fprintf(fp2, "%d\n", (lambda * (dimension + 1)));
-     
-     for(i = 0; i < lambda; i++)
+     if (transport != TRANSPORT_FILE)
      {
-	 f[i] = (double *) malloc((dimension + 1 ) * sizeof(double));
-
-	 result = fscanf(fp, "%d", &identity); /* fscanf() returns EOF
-                                                   if reading fails.*/
-	 assert(result != EOF); /* file not completely written */
-	 f[i][0] = identity;
-	 fprintf(fp2, "%d ", identity); /* prints also a space */
-	 
-	 for (j = 1; j < dimension + 1; j++)
-	 {
-	     result = fscanf(fp, "%le", &f[i][j]);
-	     assert(result != EOF); /* file not completely written */
-	     fprintf(fp2, "%E ", f[i][j]); /* prints also a space */
-	 }
-	 
-	 fprintf(fp2, "\n");
+	 f = (double **) malloc(lambda * sizeof(double*));
+	 assert (f != NULL);
+	 copy_shm_records(var_file_variator, var_file_selector, lambda, f);
+	 return (f);
      }
-     
-     fscanf(fp, "%s", tag);
-     assert(strcmp(tag, "END") == 0);
-     fprintf(fp2, "END");
-     
-     fclose(fp);
-     fclose(fp2);
-     
-     /* deleting content */
-     fp = fopen(var_file_variator, "w");
-     assert(fp != NULL);
-     fprintf(fp, "%d", 0);
-     fclose(fp);
-     
+
+     f = read_records(var_file_variator, lambda);
+     write_records(var_file_selector, f, lambda);
      return (f);  
 }
@@ -33,6 +33,31 @@
 /* this is needed for the wait function */
 #ifdef PISA_UNIX
 #include <unistd.h>
+#ifdef __linux__
+#define PISA_INOTIFY /* wait() wakes up when the state file is written */
+#include <sys/select.h>
+#include <time.h>
+#include <sys/inotify.h>
+#define PISA_FUTEX /* the shared memory transport waits on a futex */
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#define PISA_SHM /* POSIX shared memory for 'transport shm' */
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define PISA_SOCKET /* stream sockets for 'transport socket' */
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <time.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 #endif
 
 #ifdef PISA_WIN
@@ -40,24 +65,872 @@
 #endif
 
 
+int transport = TRANSPORT_FILE; /* set from the cfg files */
+int format = FORMAT_TEXT; /* set from the cfg files */
+
+/*--------------------| shared memory transport |-----------------------*/
+
+#define SHM_MAGIC 0x50495341 /* "PISA", set once the segment is set up */
+
+/* beginning of the segment; the areas of records follow */
+typedef struct shm_header_t
+{
+     int magic;           /* SHM_MAGIC */
+     int dimension;       /* number of objective values per record */
+     int capacity;        /* number of records per area */
+     int sequence;        /* incremented on every change of 'word' */
+     int word[SHM_WORDS]; /* state and number of records in each area */
+} shm_header;
+
+static shm_header *segment_variator = NULL; /* attached segments */
+static shm_header *segment_selector = NULL;
+
+static shm_header *segment_read = NULL; /* segment of the state last read */
+
+static int seen_sequence; /* its 'sequence' when the state was read */
+
+/* with the socket transport, the segments are copies in this process of
+   the words and areas the modules keep, brought up to date by
+   get_shm_word() and sent on by set_shm_word() */
+static char address_variator[CFG_ENTRY_LENGTH_INTERNAL]; /* from the */
+static char address_selector[CFG_ENTRY_LENGTH_INTERNAL]; /* cfg files */
+static int socket_variator = -1; /* connections with the modules */
+static int socket_selector = -1;
+
+
+static size_t header_bytes()
+/* Returns the size of the header, rounded up for the doubles. */
+{
+     return ((sizeof(shm_header) + 7) / 8 * 8);
+}
+
+
+static size_t ids_bytes(int capacity)
+/* Returns the size of the IDs of an area, rounded up for the doubles. */
+{
+     return ((capacity * sizeof(int) + 7) / 8 * 8);
+}
+
+
+static size_t area_bytes(int capacity)
+/* Returns the size of an area. */
+{
+     return (ids_bytes(capacity) + capacity * dimension * sizeof(double));
+}
+
+
+static char *area_start(shm_header *header, int area)
+/* Returns the start of 'area' (SHM_INI ... SHM_ARC) in 'header'. */
+{
+     return ((char *) header + header_bytes()
+             + (area - 1) * area_bytes(header->capacity));
+}
+
+
+static void wake_waiters(shm_header *header)
+/* Tells the processes waiting on 'header' that a word has changed. */
+{
+     __atomic_add_fetch(&header->sequence, 1, __ATOMIC_RELEASE);
+#ifdef PISA_FUTEX
+     syscall(SYS_futex, &header->sequence, FUTEX_WAKE, INT_MAX, NULL, NULL,
+             0);
+#endif
+}
+
+
+#ifdef PISA_SHM
+
+static int segment_name(char *filenamebase, char *name)
+/* Writes the name of the segment of 'filenamebase' to 'name', a hash
+   of the absolute path of 'filenamebase'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char dir[FILE_NAME_LENGTH_INTERNAL];
+     char path[PATH_MAX];
+     char *slash = strrchr(filenamebase, '/');
+     char *base = (slash == NULL) ? filenamebase : slash + 1;
+     unsigned long long hash = 14695981039346656037ULL; /* FNV-1a */
+     char *p;
+
+     if (slash == NULL)
+          strcpy(dir, ".");
+     else if (slash == filenamebase)
+          strcpy(dir, "/");
+     else
+     {
+          strncpy(dir, filenamebase, slash - filenamebase);
+          dir[slash - filenamebase] = '\0';
+     }
+     if (realpath(dir, path) == NULL)
+          return (1);
+     strcat(path, "/");
+     for (p = path; *p != '\0'; p++)
+          hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+     for (p = base; *p != '\0'; p++)
+          hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+     sprintf(name, "/pisa-%016llx", hash);
+     return (0);
+}
+
+
+static shm_header *attach_segment(char *filenamebase, int capacity)
+/* Maps the segment of 'filenamebase', and creates it for 'capacity'
+   records per area if it does not exist yet.
+   Returns NULL if this fails, e.g. for a segment left behind with
+   another layout. */
+{
+     char name[32];
+     size_t size = header_bytes() + (SHM_WORDS - 1) * area_bytes(capacity);
+     struct stat st;
+     shm_header *header;
+     int fd, i;
+     int created = 1;
+
+     if (segment_name(filenamebase, name) != 0)
+          return (NULL);
+     fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+     if (fd < 0 && errno == EEXIST)
+     {
+          created = 0;
+          fd = shm_open(name, O_RDWR, 0600);
+     }
+     if (fd < 0)
+          return (NULL);
+     if (created && ftruncate(fd, size) != 0)
+     {
+          close(fd);
+          shm_unlink(name);
+          return (NULL);
+     }
+     /* the process creating the segment may not have sized it yet */
+     for (i = 0; !created && i < 1000; i++)
+     {
+          if (fstat(fd, &st) != 0 || st.st_size >= (off_t) size)
+               break;
+          usleep(1000);
+     }
+     if (!created && (fstat(fd, &st) != 0 || st.st_size != (off_t) size))
+     {
+          close(fd);
+          return (NULL);
+     }
+     header = (shm_header *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, fd, 0);
+     close(fd);
+     if (header == MAP_FAILED)
+          return (NULL);
+
+     if (created) /* ftruncate() has set all words to 0 */
+     {
+          header->dimension = dimension;
+          header->capacity = capacity;
+          __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+     }
+     for (i = 0; i < 1000; i++)
+     {
+          if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC)
+               break;
+          usleep(1000);
+     }
+     if (header->magic != SHM_MAGIC || header->dimension != dimension
+         || header->capacity != capacity)
+     {
+          munmap(header, size);
+          return (NULL);
+     }
+     return (header);
+}
+
+#endif
+
+
+static shm_header *find_word(char *filename, int *word)
+/* Returns the segment holding the word for the file 'filename' and
+   stores the index of the word in 'word'. */
+{
+     char *files[2][SHM_WORDS];
+     int side, i;
+
+     files[0][SHM_STA] = sta_file_variator;
+     files[0][SHM_INI] = ini_file_variator;
+     files[0][SHM_VAR] = var_file_variator;
+     files[0][SHM_SEL] = sel_file_variator;
+     files[0][SHM_ARC] = arc_file_variator;
+     files[1][SHM_STA] = sta_file_selector;
+     files[1][SHM_INI] = ini_file_selector;
+     files[1][SHM_VAR] = var_file_selector;
+     files[1][SHM_SEL] = sel_file_selector;
+     files[1][SHM_ARC] = arc_file_selector;
+     for (side = 0; side < 2; side++)
+     {
+          for (i = 0; i < SHM_WORDS; i++)
+          {
+               if (strcmp(filename, files[side][i]) == 0)
+               {
+                    *word = i;
+                    return ((side == 0) ? segment_variator
+                            : segment_selector);
+               }
+          }
+     }
+     assert(0); /* not a file of the variator or the selector */
+     return (NULL);
+}
+
+
+/*-------------------------| socket transport |-------------------------*/
+
+#ifdef PISA_SOCKET
+
+static int module_address(char *address, char *role, char *result)
+/* Writes the address on which the module 'role' ("variator" or
+   "selector") listens to 'result' (CFG_ENTRY_LENGTH_INTERNAL
+   characters), as the modules derive it: for the path of a Unix domain
+   socket 'address' followed by '.' and 'role', for 'host:port' the port
+   itself for the variator and the next one for the selector.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char *colon = strrchr(address, ':');
+     char *end;
+     long port;
+     int length;
+
+     if (colon == NULL)
+          length = snprintf(result, CFG_ENTRY_LENGTH_INTERNAL, "%s.%s",
+                            address, role);
+     else
+     {
+          port = strtol(colon + 1, &end, 10);
+          if (end == colon + 1 || *end != '\0' || port < 1 || port > 65534)
+               return (1);
+          if (strcmp(role, "selector") == 0)
+               port++;
+          length = snprintf(result, CFG_ENTRY_LENGTH_INTERNAL, "%.*s:%ld",
+                            (int) (colon - address), address, port);
+     }
+     return (length < 0 || length >= CFG_ENTRY_LENGTH_INTERNAL);
+}
+
+
+static int connect_to(char *address)
+/* Returns a socket connected to 'address', 'host:port' or the path of a
+   Unix domain socket, or -1 if this fails (e.g. the module does not
+   listen yet). */
+{
+     struct sockaddr_un local;
+     struct addrinfo hints, *list, *p;
+     char host[CFG_ENTRY_LENGTH_INTERNAL];
+     char *colon = strrchr(address, ':');
+     int fd = -1;
+     int on = 1;
+
+     if (colon == NULL) /* Unix domain socket */
+     {
+          if (strlen(address) >= sizeof(local.sun_path))
+               return (-1);
+          memset(&local, 0, sizeof(local));
+          local.sun_family = AF_UNIX;
+          strcpy(local.sun_path, address);
+          fd = socket(AF_UNIX, SOCK_STREAM, 0);
+          if (fd >= 0 && connect(fd, (struct sockaddr *) &local,
+                                 sizeof(local)) != 0)
+          {
+               close(fd);
+               fd = -1;
+          }
+          return (fd);
+     }
+
+     strncpy(host, address, colon - address);
+     host[colon - address] = '\0';
+     memset(&hints, 0, sizeof(hints));
+     hints.ai_family = AF_UNSPEC;
+     hints.ai_socktype = SOCK_STREAM;
+     if (getaddrinfo((host[0] == '\0') ? NULL : host, colon + 1, &hints,
+                     &list) != 0)
+          return (-1);
+     for (p = list; p != NULL && fd < 0; p = p->ai_next)
+     {
+          fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+          if (fd < 0)
+               continue;
+          if (connect(fd, p->ai_addr, p->ai_addrlen) != 0)
+          {
+               close(fd);
+               fd = -1;
+          }
+     }
+     freeaddrinfo(list);
+     if (fd >= 0) /* requests are small and answered at once */
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+     return (fd);
+}
+
+
+static int connect_module(char *address, char *role)
+/* Connects to the module 'role' ("variator" or "selector") listening on
+   its address derived from 'address', waiting for it to start if
+   needed, and exits if it does not listen within
+   SOCKET_CONNECT_TIMEOUT seconds. Returns the socket. */
+{
+     char own[CFG_ENTRY_LENGTH_INTERNAL];
+     time_t start = time(NULL);
+     int fd;
+
+     if (module_address(address, role, own) != 0)
+     {
+          printf("Monitor - invalid socket address %s\n", address);
+          exit(1);
+     }
+     fd = connect_to(own);
+     if (fd < 0)
+          printf("Monitor - waiting for the %s on %s\n", role, own);
+     while (fd < 0)
+     {
+          if (difftime(time(NULL), start) > SOCKET_CONNECT_TIMEOUT)
+          {
+               printf("Monitor - the %s does not listen on %s\n", role,
+                      own);
+               exit(1);
+          }
+          wait(poll);
+          fd = connect_to(own);
+     }
+     return (fd);
+}
+
+
+static void send_all(int fd, void *buffer, size_t size)
+/* Writes 'size' bytes from 'buffer' to the socket 'fd', and exits if
+   the connection is lost. */
+{
+     char *p = (char *) buffer;
+     ssize_t n;
+
+     while (size > 0)
+     {
+          n = send(fd, p, size, MSG_NOSIGNAL);
+          if (n < 0 && errno == EINTR)
+               continue;
+          if (n <= 0)
+          {
+               printf("Monitor - lost the connection to a module\n");
+               exit(EXIT_FAILURE);
+          }
+          p += n;
+          size -= n;
+     }
+}
+
+
+static void recv_all(int fd, void *buffer, size_t size)
+/* Reads 'size' bytes from the socket 'fd' into 'buffer', and exits if
+   the connection is lost. */
+{
+     char *p = (char *) buffer;
+     ssize_t n;
+
+     while (size > 0)
+     {
+          n = recv(fd, p, size, 0);
+          if (n < 0 && errno == EINTR)
+               continue;
+          if (n <= 0)
+          {
+               printf("Monitor - lost the connection to a module\n");
+               exit(EXIT_FAILURE);
+          }
+          p += n;
+          size -= n;
+     }
+}
+
+
+static void transfer_records(int fd, shm_header *header, int word,
+                             int count, int sending)
+/* Sends the 'count' records of the area of 'word' in 'header' over the
+   socket 'fd', or receives them into the area if 'sending' is 0. The
+   state has none. */
+{
+     char *ids = area_start(header, word);
+     char *values = ids + ids_bytes(header->capacity);
+     size_t values_size = 0;
+
+     if (word == SHM_STA || count == 0)
+          return;
+     assert(count > 0 && count <= header->capacity);
+     if (word == SHM_INI || word == SHM_VAR)
+          values_size = (size_t) count * dimension * sizeof(double);
+     if (sending)
+     {
+          send_all(fd, ids, count * sizeof(int));
+          send_all(fd, values, values_size);
+     }
+     else
+     {
+          recv_all(fd, ids, count * sizeof(int));
+          recv_all(fd, values, values_size);
+     }
+}
+
+
+static void fetch_word(shm_header *header, int word)
+/* Reads the word 'word', and its records, from the module 'header'
+   stands for into 'header'. */
+{
+     int fd = (header == segment_variator) ? socket_variator
+          : socket_selector;
+     int message[4] = {SOCKET_MAGIC, SOCKET_GET, 0, 0};
+
+     message[2] = word;
+     send_all(fd, message, sizeof(message));
+     recv_all(fd, message, sizeof(message));
+     assert(message[0] == SOCKET_MAGIC && message[2] == word);
+     transfer_records(fd, header, word, message[3], 0);
+     header->word[word] = message[3];
+}
+
+
+static void send_word(shm_header *header, int word, int value)
+/* Sets the word 'word' to 'value' in the module 'header' stands for,
+   with the records of its area in 'header'. */
+{
+     int fd = (header == segment_variator) ? socket_variator
+          : socket_selector;
+     int message[4] = {SOCKET_MAGIC, SOCKET_SET, 0, 0};
+
+     message[2] = word;
+     message[3] = value;
+     send_all(fd, message, sizeof(message));
+     transfer_records(fd, header, word, value, 1);
+}
+
+
+static void wait_for_state(shm_header *header)
+/* Waits until the module 'header' stands for has written another state
+   than the one last read from it. */
+{
+     int fd = (header == segment_variator) ? socket_variator
+          : socket_selector;
+     int message[4] = {SOCKET_MAGIC, SOCKET_WAIT, SHM_STA, 0};
+
+     message[3] = header->word[SHM_STA];
+     send_all(fd, message, sizeof(message));
+     recv_all(fd, message, sizeof(message));
+     assert(message[0] == SOCKET_MAGIC && message[2] == SHM_STA);
+     header->word[SHM_STA] = message[3];
+}
+
+
+static shm_header *new_copy(int capacity)
+/* Returns a segment in the memory of this process for 'capacity'
+   records per area, or NULL if this fails. */
+{
+     shm_header *header = (shm_header *) calloc(1, header_bytes()
+                                                + (SHM_WORDS - 1)
+                                                * area_bytes(capacity));
+     if (header != NULL)
+     {
+          header->magic = SHM_MAGIC;
+          header->dimension = dimension;
+          header->capacity = capacity;
+     }
+     return (header);
+}
+
+#endif
+
+
+static int wait_for_change(double sec)
+/* Sleeps until a word of the segment of the state last read changes
+   after that state was read, but at most 'sec' seconds.
+   Returns 0 if it waited and 1 if futexes are not available. */
+{
+#ifdef PISA_FUTEX
+     struct timespec timeout;
+
+     if (segment_read == NULL)
+          return (1);
+     timeout.tv_sec = (time_t) floor(sec);
+     timeout.tv_nsec = (long) ((sec - floor(sec)) * 1e9);
+     syscall(SYS_futex, &segment_read->sequence, FUTEX_WAIT, seen_sequence,
+             &timeout, NULL, 0);
+     return (0);
+#else
+     return (1);
+#endif
+}
+
+
+int open_transport()
+/* Attaches the shared memory segments of the variator and the selector
+   if the cfg files ask for 'transport shm', or connects to them if they
+   ask for 'transport socket'.
+   Returns 0 if successful and 1 otherwise. */
+{
+     if (transport == TRANSPORT_SOCKET)
+     {
+#ifdef PISA_SOCKET
+          segment_variator = new_copy(alpha + mu + lambda);
+          segment_selector = new_copy(alpha + mu + lambda);
+          if (segment_variator != NULL && segment_selector != NULL)
+          {
+               socket_variator = connect_module(address_variator,
+                                                "variator");
+               socket_selector = connect_module(address_selector,
+                                                "selector");
+               return (0);
+          }
+#endif
+          printf("Monitor - cannot set up the socket transport\n");
+          return (1);
+     }
+     if (transport != TRANSPORT_SHM)
+          return (0);
+#ifdef PISA_SHM
+     segment_variator = attach_segment(filenamebase_variator,
+                                       alpha + mu + lambda);
+     segment_selector = attach_segment(filenamebase_selector,
+                                       alpha + mu + lambda);
+#endif
+     if (segment_variator == NULL || segment_selector == NULL)
+     {
+          printf("Monitor - cannot attach shared memory segments\n");
+          return (1);
+     }
+     return (0);
+}
+
+
+void use_memory_segment(void *memory)
+/* Lets the files of the variator and of the selector stand for the
+   words and areas of the segment 'memory' that both use in this process
+   (see driver_c_source). */
+{
+     segment_variator = (shm_header *) memory;
+     segment_selector = (shm_header *) memory;
+     transport = TRANSPORT_SHM;
+}
+
+
+void close_transport()
+/* Removes the shared memory segments, which stay mapped in the
+   processes still using them. */
+{
+#ifdef PISA_SHM
+     char name[32];
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET) /* the modules terminate then */
+     {
+          close(socket_variator);
+          close(socket_selector);
+          socket_variator = socket_selector = -1;
+          return;
+     }
+#endif
+     if (transport != TRANSPORT_SHM)
+          return;
+     if (segment_name(filenamebase_variator, name) == 0)
+          shm_unlink(name);
+     if (segment_name(filenamebase_selector, name) == 0)
+          shm_unlink(name);
+#endif
+}
+
+
+int get_shm_word(char *filename)
+/* Returns the word for the file 'filename' in its segment. */
+{
+     int word;
+     shm_header *header = find_word(filename, &word);
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET)
+          fetch_word(header, word);
+#endif
+     return (__atomic_load_n(&header->word[word], __ATOMIC_ACQUIRE));
+}
+
+
+void set_shm_word(char *filename, int value)
+/* Sets the word for the file 'filename' in its segment and wakes up the
+   processes waiting for a change. */
+{
+     int word;
+     shm_header *header = find_word(filename, &word);
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET)
+          send_word(header, word, value);
+#endif
+     __atomic_store_n(&header->word[word], value, __ATOMIC_RELEASE);
+     wake_waiters(header);
+}
+
+
+int *shm_ids(char *filename)
+/* Returns the IDs of the records in the area for the file 'filename'. */
+{
+     int area;
+     shm_header *header = find_word(filename, &area);
+
+     return ((int *) area_start(header, area));
+}
+
+
+double *shm_values(char *filename)
+/* Returns the objective values of the records in the area for the file
+   'filename'. */
+{
+     int area;
+     shm_header *header = find_word(filename, &area);
+
+     return ((double *) (area_start(header, area)
+                         + ids_bytes(header->capacity)));
+}
+
+
+/*-------------------------| data files |-------------------------------*/
+
+static void temp_name(char *filename, char *temp)
+/* Writes the name of the temporary file for 'filename' to 'temp'. */
+{
+     sprintf(temp, "%s.tmp", filename);
+}
+
+
+FILE *begin_file(char *filename)
+/* Opens the temporary file for writing the new content of 'filename'.
+   Returns NULL if this fails. */
+{
+     char temp[FILE_NAME_LENGTH_INTERNAL + 4];
+
+     temp_name(filename, temp);
+     return (fopen(temp, "wb"));
+}
+
+
+int publish_file(FILE *fp, char *filename)
+/* Closes 'fp', opened by begin_file(), and renames it to 'filename', so
+   readers see either the previous or the whole new content.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char temp[FILE_NAME_LENGTH_INTERNAL + 4];
+     int result = 0;
+
+     temp_name(filename, temp);
+     if (fflush(fp) != 0)
+          result = 1;
+#if defined(PISA_UNIX) && defined(PISA_FSYNC)
+     if (result == 0 && fsync(fileno(fp)) != 0)
+          result = 1;
+#endif
+     if (fclose(fp) != 0)
+          result = 1;
+#ifdef PISA_WIN
+     remove(filename); /* rename() does not replace files on Windows */
+#endif
+     if (result == 0 && rename(temp, filename) != 0)
+          result = 1;
+     if (result != 0)
+          remove(temp);
+     return (result);
+}
+
+
+void empty_file(char *filename)
+/* Leaves only '0' in the file 'filename'. */
+{
+     FILE *fp;
+     int result;
+
+     fp = begin_file(filename);
+     assert(fp != NULL);
+     fprintf(fp, "%d", 0);
+     result = publish_file(fp, filename);
+     assert(result == 0);
+}
+
+
+static char *read_file(char *filename, size_t *size)
+/* Reads the whole file 'filename' with a single read into a buffer
+   terminated by '\0' and stores its size in 'size'.
+   Returns NULL if this fails. */
+{
+     FILE *fp;
+     long length = -1;
+     char *buffer = NULL;
+
+     fp = fopen(filename, "rb");
+     if (fp == NULL)
+          return (NULL);
+     setvbuf(fp, NULL, _IONBF, 0); /* no copy into a stdio buffer */
+     if (fseek(fp, 0, SEEK_END) == 0)
+          length = ftell(fp);
+     if (length >= 0 && fseek(fp, 0, SEEK_SET) == 0)
+          buffer = (char *) malloc(length + 1);
+     if (buffer != NULL)
+     {
+          *size = fread(buffer, 1, length, fp);
+          buffer[*size] = '\0';
+     }
+     fclose(fp);
+     return (buffer);
+}
+
+
+/*-------------------------| binary files |-----------------------------*/
+
+#define BINARY_MAGIC "PISB" /* no digit, so check_*() see a full file */
+
+#define BINARY_HEADER 16 /* bytes before the IDs */
+
+
+static size_t binary_ids_bytes(int count)
+/* Returns the size of 'count' IDs, rounded up for the doubles. */
+{
+     return ((count * sizeof(int) + 7) / 8 * 8);
+}
+
+
+static int little_endian()
+/* Returns 1 if this host stores numbers little-endian, as the binary
+   format does, and 0 otherwise. */
+{
+     int one = 1;
+     return (*(char *) &one == 1);
+}
+
 
-/*--------------------| global variable definitions |-------------------*/
+int new_binary(binary_data *data, int count, int dimension)
+/* Allocates the buffer of 'data' for 'count' records and sets up the
+   header. Returns 0 if successful and 1 otherwise. */
+{
+     int header[3];
 
-/* declared in variator_internal.h used in other files as well */
+     data->count = count;
+     data->dimension = dimension;
+     data->size = BINARY_HEADER + binary_ids_bytes(count)
+          + (size_t) count * dimension * sizeof(double);
+     data->buffer = (char *) calloc(data->size, 1);
+     if (data->buffer == NULL)
+          return (1);
+     header[0] = count;
+     header[1] = dimension;
+     header[2] = 0;
+     memcpy(data->buffer, BINARY_MAGIC, 4);
+     memcpy(data->buffer + 4, header, sizeof(header));
+     data->ids = (int *) (data->buffer + BINARY_HEADER);
+     data->values = (double *) (data->buffer + BINARY_HEADER
+                                + binary_ids_bytes(count));
+     return (0);
+}
 
-char cfg_file_variator[FILE_NAME_LENGTH_INTERNAL];  
-char ini_file_variator[FILE_NAME_LENGTH_INTERNAL];  
-char sel_file_variator[FILE_NAME_LENGTH_INTERNAL]; 
-char arc_file_variator[FILE_NAME_LENGTH_INTERNAL]; 
-char var_file_variator[FILE_NAME_LENGTH_INTERNAL]; 
-char sta_file_variator[FILE_NAME_LENGTH_INTERNAL]; 
-char cfg_file_selector[FILE_NAME_LENGTH_INTERNAL];  
-char ini_file_selector[FILE_NAME_LENGTH_INTERNAL];  
-char sel_file_selector[FILE_NAME_LENGTH_INTERNAL]; 
-char arc_file_selector[FILE_NAME_LENGTH_INTERNAL]; 
-char var_file_selector[FILE_NAME_LENGTH_INTERNAL]; 
-char sta_file_selector[FILE_NAME_LENGTH_INTERNAL]; 
 
+int write_binary(char *filename, binary_data *data)
+/* Writes 'data' to 'filename' with a single write, through
+   begin_file() and publish_file(), and frees its buffer.
+   Returns 0 if successful and 1 otherwise. */
+{
+     FILE *fp;
+     size_t written = 0;
+
+     fp = begin_file(filename);
+     if (fp != NULL)
+     {
+          setvbuf(fp, NULL, _IONBF, 0); /* no copy into a stdio buffer */
+          written = fwrite(data->buffer, 1, data->size, fp);
+          if (publish_file(fp, filename) != 0)
+               written = 0;
+     }
+     free(data->buffer);
+     data->buffer = NULL;
+     return (written == data->size ? 0 : 1);
+}
+
+
+static int parse_text(char *text, int dimension, binary_data *data)
+/* Parses 'text', the content of a data file in the text format, into
+   'data' as if it had been read in the binary format. The first number
+   is the number of IDs in sel and arc files ('dimension' 0) and the
+   number of all numbers in ini and var files.
+   Returns 0 if successful and 1 if 'text' is incomplete or invalid. */
+{
+     char *end;
+     long size;
+     int count, i, j;
+
+     size = strtol(text, &end, 10);
+     if (end == text || size < 0 || size % (dimension + 1) != 0)
+          return (1);
+     count = (int) (size / (dimension + 1));
+     if (new_binary(data, count, dimension) != 0)
+          return (1);
+     for (i = 0; i < count; i++)
+     {
+          text = end;
+          data->ids[i] = (int) strtol(text, &end, 10);
+          for (j = 0; j < dimension && end != text; j++)
+          {
+               text = end;
+               data->values[i * dimension + j] = strtod(text, &end);
+          }
+          if (end == text) /* file not completely written */
+               break;
+     }
+     while (*end == ' ' || *end == '\n' || *end == '\r' || *end == '\t')
+          end++;
+     if (i < count || strncmp(end, "END", 3) != 0)
+     {
+          free(data->buffer);
+          data->buffer = NULL;
+          return (1);
+     }
+     return (0);
+}
+
+
+int read_data(char *filename, int dimension, binary_data *data)
+/* Reads the data file 'filename', in either format, into 'data' with a
+   single read of the whole file. 'dimension' is the number of objective
+   values per record, 0 for sel and arc files. Returns 0 if successful
+   (free 'data->buffer' when done) and 1 if the file cannot be read or
+   is not completely written or invalid. */
+{
+     char *buffer;
+     size_t size;
+     int numbers[3];
+     int result;
+
+     buffer = read_file(filename, &size);
+     if (buffer == NULL)
+          return (1);
+     if (size < 4 || memcmp(buffer, BINARY_MAGIC, 4) != 0)
+     {
+          result = parse_text(buffer, dimension, data);
+          free(buffer);
+          return (result);
+     }
+
+     if (size >= BINARY_HEADER)
+          memcpy(numbers, buffer + 4, sizeof(numbers));
+     if (size < BINARY_HEADER || numbers[0] < 0 || numbers[1] != dimension
+         || size != BINARY_HEADER + binary_ids_bytes(numbers[0])
+         + (size_t) numbers[0] * dimension * sizeof(double))
+     {
+          free(buffer);
+          return (1);
+     }
+     data->count = numbers[0];
+     data->dimension = dimension;
+     data->buffer = buffer;
+     data->size = size;
+     data->ids = (int *) (buffer + BINARY_HEADER);
+     data->values = (double *) (buffer + BINARY_HEADER
+                                + binary_ids_bytes(data->count));
+     return (0);
+}
 
 
 /*-------------------------| functions for handling state file |--------*/
@@ -69,6 +942,12 @@ int write_state(char *filename, int state)
 
      assert(0 <= state <= 11);
      
+     if (transport != TRANSPORT_FILE)
+     {
+          set_shm_word(filename, state);
+          return (0);
+     }
+
      fp = fopen(filename, "w");
      assert(fp != NULL);
      fprintf(fp, "%d", state);
@@ -83,6 +962,21 @@ int read_state(char *filename)
      int result;
      int state = -1;
      FILE *fp;
+     int word;
+
+     if (transport == TRANSPORT_SOCKET)
+     {
+          segment_read = find_word(filename, &word);
+          return (get_shm_word(filename));
+     }
+     if (transport == TRANSPORT_SHM)
+     {
+          segment_read = find_word(filename, &word);
+          seen_sequence = __atomic_load_n(&segment_read->sequence,
+                                          __ATOMIC_ACQUIRE);
+          return (get_shm_word(filename));
+     }
+
      fp = fopen(filename, "r");
      if (fp != NULL)
      {
@@ -106,6 +1000,127 @@ int state_error(int error, int linenumber)
 }
 
 
+#ifdef PISA_INOTIFY
+
+static int notify_fd = -2;
+/* inotify instance watching the directory of the state file; -1 if
+   inotify is not available, -2 before the first call of wait() */
+
+
+static int watch_directory(char *file)
+/* Adds the directory of 'file' to the directories watched by
+   'notify_fd' for files written or moved there.
+   Returns 0 if successful and 1 otherwise. */
+{
+     char dir[FILE_NAME_LENGTH_INTERNAL];
+     char *slash = strrchr(file, '/');
+
+     if (slash == NULL)
+          strcpy(dir, ".");
+     else if (slash == file)
+          strcpy(dir, "/");
+     else
+     {
+          strncpy(dir, file, slash - file);
+          dir[slash - file] = '\0';
+     }
+     if (inotify_add_watch(notify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+          return (1);
+     return (0);
+}
+
+
+static int is_file(const char *name, char *file)
+/* Returns 1 if 'name' is the last component of the path 'file' and 0
+   otherwise. */
+{
+     char *slash = strrchr(file, '/');
+     return (strcmp(name, (slash == NULL) ? file : slash + 1) == 0);
+}
+
+
+static int state_file_written()
+/* Reads all pending events from 'notify_fd'. Returns 1 if one of them
+   may concern the state file and 0 otherwise. */
+{
+     union
+     {
+          struct inotify_event event; /* for the alignment */
+          char bytes[4096];
+     } buffer;
+     struct inotify_event *event;
+     ssize_t length;
+     char *p;
+     int found = 0;
+
+     while ((length = read(notify_fd, buffer.bytes, sizeof(buffer))) > 0)
+     {
+          for (p = buffer.bytes; p < buffer.bytes + length;
+               p += sizeof(struct inotify_event) + event->len)
+          {
+               event = (struct inotify_event *) p;
+               if ((event->mask & IN_Q_OVERFLOW)
+                   || (event->len > 0 && (is_file(event->name, sta_file_variator)
+                           || is_file(event->name, sta_file_selector))))
+                    found = 1;
+          }
+     }
+     return (found);
+}
+
+
+static int wait_for_state_file(double sec)
+/* Sleeps until the state file is written, but at most 'sec' seconds.
+   Returns 0 if it waited and 1 if inotify is not available. */
+{
+     struct timespec now, end;
+     struct timeval timeout;
+     fd_set fds;
+     long usec;
+
+     if (notify_fd == -2)
+     {
+          notify_fd = inotify_init1(IN_NONBLOCK);
+          if (notify_fd >= 0 && (watch_directory(sta_file_variator) != 0
+                                 || watch_directory(sta_file_selector) != 0))
+          {
+               close(notify_fd);
+               notify_fd = -1;
+          }
+     }
+     if (notify_fd < 0)
+          return (1);
+
+     clock_gettime(CLOCK_MONOTONIC, &end);
+     end.tv_sec += (time_t) floor(sec);
+     end.tv_nsec += (long) ((sec - floor(sec)) * 1e9);
+     if (end.tv_nsec >= 1000000000L)
+     {
+          end.tv_sec++;
+          end.tv_nsec -= 1000000000L;
+     }
+     /* events queued since the last call count as well, so a state
+        written while this process was busy is not missed */
+     while (!state_file_written())
+     {
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          usec = (end.tv_sec - now.tv_sec) * 1000000L
+               + (end.tv_nsec - now.tv_nsec + 999) / 1000;
+          if (usec <= 0)
+               break;
+          timeout.tv_sec = usec / 1000000L;
+          timeout.tv_usec = usec % 1000000L;
+          FD_ZERO(&fds);
+          FD_SET(notify_fd, &fds);
+          if (select(notify_fd + 1, &fds, NULL, NULL, &timeout) <= 0)
+               break; /* time is up (or interrupted) */
+     }
+     return (0);
+}
+
+#endif
+
+
 int wait(double sec)
 /* Makes the calling process sleep for 'sec' seconds.
    
@@ -134,6 +1149,20 @@ int wait(double sec)
      assert((int_sec * 1e6) + usec >= 10000);  /* you might change this one
                                                   if you know what you are
                                                   doing */
+
+#ifdef PISA_SOCKET
+     if (transport == TRANSPORT_SOCKET && segment_read != NULL)
+     {
+          wait_for_state(segment_read);
+          return (0);
+     }
+#endif
+     if (transport == TRANSPORT_SHM && wait_for_change(sec) == 0)
+          return (0);
+#ifdef PISA_INOTIFY
+     if (wait_for_state_file(sec) == 0)
+          return (0);
+#endif
     
      sleep(int_sec);
      usleep(usec);
@@ -164,6 +1193,9 @@ int read_common_parameters(char *filename)
      int new_mu;
      int new_lambda;
      int new_dimension;     
+     int new_transport = TRANSPORT_FILE;
+     char new_address[CFG_ENTRY_LENGTH_INTERNAL] = "";
+     int new_format = FORMAT_TEXT;
      char str[CFG_ENTRY_LENGTH_INTERNAL];
 
      /* reading cfg file with common configurations for both parts */
@@ -191,14 +1223,60 @@ int read_common_parameters(char *filename)
      assert(result != EOF); /* no EOF, dim correctly read */
      assert(new_dimension > 0);
 
+     /* optional entries */
+     while (fscanf(fp, "%s", str) == 1)
+     {
+          if (strcmp(str, "transport") == 0)
+          {
+               result = fscanf(fp, "%s", str);
+               assert(result == 1);
+               if (strcmp(str, "shm") == 0)
+                    new_transport = TRANSPORT_SHM;
+               else if (strcmp(str, "socket") == 0)
+               {
+                    new_transport = TRANSPORT_SOCKET;
+                    result = fscanf(fp, "%s", new_address);
+                    assert(result == 1);
+               }
+               else
+               {
+                    assert(strcmp(str, "file") == 0);
+                    new_transport = TRANSPORT_FILE;
+               }
+          }
+          else
+          {
+               assert(strcmp(str, "format") == 0);
+               result = fscanf(fp, "%s", str);
+               assert(result == 1);
+               /* a big-endian host stays with the text format */
+               if (strcmp(str, "binary") == 0 && little_endian())
+                    new_format = FORMAT_BINARY;
+               else
+               {
+                    assert(strcmp(str, "binary") == 0
+                           || strcmp(str, "text") == 0);
+                    new_format = FORMAT_TEXT;
+               }
+          }
+     }
+
      fclose(fp);     
 
+     /* each module listens on the address in its own cfg file */
+     if (strcmp(filename, cfg_file_variator) == 0)
+          strcpy(address_variator, new_address);
+     else
+          strcpy(address_selector, new_address);
+
      if (alpha == 0)
      {
 	 alpha = new_alpha;
 	 mu = new_mu;
 	 lambda = new_lambda;
 	 dimension = new_dimension;
+	 transport = new_transport;
+	 format = new_format;
 	 
      }
      else
@@ -208,6 +1286,8 @@ int read_common_parameters(char *filename)
 	 assert(new_mu == mu);
 	 assert(new_lambda == lambda);
 	 assert(new_dimension == dimension);
+	 assert(new_transport == transport);
+	 assert(new_format == format);
      }
      return (0);
 }
@@ -220,6 +1300,9 @@ int check_file(char* filename)
 
      FILE *fp;
 
+     if (transport != TRANSPORT_FILE)
+          return (get_shm_word(filename) != 0);
+
      fp = fopen(filename, "r");
      assert(fp != NULL);
      
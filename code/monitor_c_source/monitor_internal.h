@@ -51,6 +51,14 @@ int wait(double sec);
   post: Calling process is sleeping for 'sec' * 1e6 microseconds.
         The requested time is rounded up to the next integer multiple
         of the resolution the system can deliver.
+        On Linux the process wakes up earlier as soon as the state file
+        is written (watched with inotify), or with the shared memory
+        transport, as soon as the segment of the state last read is
+        written (with a futex); it falls back to sleeping if neither is
+        available.
+        With the socket transport, it returns once the module whose
+        state was read last has written another state (see
+        SOCKET_WAIT), however long that takes.
 
   CAUTION: sleep and usleep() are not standard C, use Sleep(milliseconds)
            in <windows.h> for Windows version.
@@ -58,6 +66,152 @@ int wait(double sec);
 
 
 
+/*-------------------| shared memory transport |------------------------*/
+
+/* With the entry 'transport shm' in the cfg files, the variator and the
+   selector exchange the state and the contents of the ini, var, sel
+   and arc files through POSIX shared memory segments instead of the
+   files, one segment per filename base (see selector_internal.h and
+   variator_internal.h). The functions below take the name of the file
+   a word or an area stands for, so read_state(), write_state() and
+   check_file() work for both transports. */
+
+#define TRANSPORT_FILE 0 /* exchange through the files (default) */
+#define TRANSPORT_SHM 1  /* exchange through shared memory */
+#define TRANSPORT_SOCKET 2 /* exchange over sockets (see below) */
+
+#define SHM_STA 0 /* words of a segment, and areas for the data files */
+#define SHM_INI 1
+#define SHM_VAR 2
+#define SHM_SEL 3
+#define SHM_ARC 4
+#define SHM_WORDS 5
+
+extern int transport; /* TRANSPORT_FILE, TRANSPORT_SHM or
+                         TRANSPORT_SOCKET */
+
+/* With the entry 'transport socket <address>' in the cfg files, the
+   variator and the selector keep their words and areas in their own
+   memory and listen on addresses derived from the <address> of their
+   cfg file, 'host:port' or the path of a Unix domain socket, for the
+   monitor to connect to: the variator on 'port' or the path followed by
+   '.variator', the selector on 'port' + 1 or the path followed by
+   '.selector'. The monitor gives up on a module that does not listen
+   within SOCKET_CONNECT_TIMEOUT seconds. The
+   messages are described in selector_internal.h and
+   variator_internal.h. The monitor keeps copies of the words and areas
+   in the segments below: get_shm_word() reads a word and the records of
+   its area from the module and set_shm_word() sends them, so the data
+   are moved as with shared memory. */
+
+#define SOCKET_MAGIC 0x4b534950 /* "PISK" */
+#define SOCKET_GET 1  /* read a word, and its records */
+#define SOCKET_SET 2  /* write a word, and its records */
+#define SOCKET_WAIT 3 /* read the state once it has changed */
+#define SOCKET_CONNECT_TIMEOUT 60 /* seconds the monitor waits for a
+                                     module to listen */
+
+int open_transport(void);
+/* Attaches the shared memory segments of the variator and the selector
+   if the cfg files ask for 'transport shm', or connects to them (waiting
+   for them to listen) if they ask for 'transport socket'.
+   Returns 0 if successful and 1 otherwise. */
+
+void close_transport(void);
+/* Removes the shared memory segments, which stay mapped in the
+   processes still using them, or closes the connections, upon which
+   the modules terminate. */
+
+void use_memory_segment(void *memory);
+/* Lets the files of the variator and of the selector stand for the
+   words and areas of the segment 'memory' that both use when they run
+   in one program (see driver_c_source). */
+
+int get_shm_word(char *filename);
+/* Returns the word for the file 'filename': the state, or the number of
+   records in the area, 0 standing for a file containing only '0'. */
+
+void set_shm_word(char *filename, int value);
+/* Sets the word for the file 'filename' and wakes up the processes
+   waiting for a change. */
+
+int *shm_ids(char *filename);
+/* Returns the IDs of the records in the area for 'filename'. */
+
+double *shm_values(char *filename);
+/* Returns the objective values of the records in the area for
+   'filename' (an ini or var file), 'dimension' values per record. */
+
+
+/*-------------------------| data files |-------------------------------*/
+
+/* The ini, var, sel and arc files are written to a temporary file
+   (the name with '.tmp' appended) that is renamed into place when it
+   is complete, so a reader never sees a partly written file and does
+   not have to read it again. Readers read a whole file with a single
+   read (read_data()). */
+
+/* #define PISA_FSYNC */ /**** define to fsync() the data files before
+                            renaming them, so that they survive a crash
+                            of the host (Unix only) */
+
+FILE *begin_file(char *filename);
+/* Opens the temporary file for writing the new content of 'filename'.
+   Returns NULL if this fails. */
+
+int publish_file(FILE *fp, char *filename);
+/* Closes 'fp', opened by begin_file(), and renames it to 'filename'.
+   Returns 0 if successful and 1 otherwise. */
+
+void empty_file(char *filename);
+/* Leaves only '0' in the file 'filename'. */
+
+
+/*-------------------------| binary files |-----------------------------*/
+
+/* With the entry 'format binary' in the cfg file, the ini, var, sel and
+   arc files are written in a binary format: the magic "PISB", the
+   number of records, the number of objective values per record (0 in
+   sel and arc files) and an unused word, all 32 bit; then the IDs,
+   padded to a multiple of 8 bytes, and the objective values as
+   doubles, all little-endian. A file is written with a single write.
+   The readers accept both formats, so modules that only know the text
+   format can still be given the text files, and a file emptied by its
+   reader always contains the text '0'. */
+
+#define FORMAT_TEXT 0   /* text files (default) */
+#define FORMAT_BINARY 1 /* binary files */
+
+extern int format; /* format of the files written, FORMAT_TEXT or
+                      FORMAT_BINARY */
+
+typedef struct binary_data_t
+{
+     int count;      /* number of records */
+     int dimension;  /* objective values per record */
+     int *ids;       /* IDs of the records */
+     double *values; /* objective values, 'dimension' per record */
+     char *buffer;   /* the whole file */
+     size_t size;    /* its size in bytes */
+} binary_data;
+
+int new_binary(binary_data *data, int count, int dimension);
+/* Allocates the buffer of 'data' for 'count' records with 'dimension'
+   objective values each and sets up the header; the caller fills in
+   'ids' and 'values'. Returns 0 if successful and 1 otherwise. */
+
+int write_binary(char *filename, binary_data *data);
+/* Writes 'data' to 'filename' and frees its buffer.
+   Returns 0 if successful and 1 otherwise. */
+
+int read_data(char *filename, int dimension, binary_data *data);
+/* Reads the data file 'filename', in either format, into 'data' with a
+   single read of the whole file. 'dimension' is the number of objective
+   values per record, 0 for sel and arc files. Returns 0 if successful
+   (free 'data->buffer' when done) and 1 if the file cannot be read or
+   is not completely written or invalid. */
+
+
 /*----------------------| other functions |----------------------------*/
 
 int read_common_parameters(char *filename);